@@ -5,86 +5,116 @@
 #include <type_traits>
 #include <algorithm>
 #include <utility>
+#include <memory>
 #include "mabitset.hpp"
+#include "mabit_pool.hpp"
+#include "mabit_expr.hpp"
+#include "mabit_kernel.hpp"
+#include "mabit_montgomery.hpp"
+#include "mabit_barrett.hpp"
+
+// C++20 gets operator <=> on top of compare()
+#if defined(__cpp_impl_three_way_comparison) && defined(__has_include)
+# if __has_include(<compare>)
+#  include <compare>
+#  ifdef __cpp_lib_three_way_comparison
+#   define MABIT_THREE_WAY_COMPARISON
+#  endif
+# endif
+#endif
 
 namespace Mabit
 {
-  template<typename word_t>
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
   class mabit_stream;
 
-  template<typename word_t>
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_modulus;
+
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_gcd;
+
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_root;
+
+  /**
+   ** \brief
+   ** Signed integer of arbitrary size, made of `word_t` words
+   ** Words bigger than the inline buffer of mabit_storage, and the scratch space of the computations, come from `alloc_t`
+   */
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
   class mabit
   {
   public:
     static_assert(std::is_unsigned<word_t>::value, "Mabit: template parameter `word_t` should be unsigned.");
-    static_assert(sizeof(word_t) < sizeof(unsigned long long), "Mabit: sizeof `word_t` should be < 64 bits");
-
     typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
 
-    typedef mabit<word_t>				mabit_t;
-    typedef mabitset<word_t>				set_t;
+    static_assert(sizeof(word_t) < sizeof(dword_t), "Mabit: 64 bits `word_t` requires unsigned __int128 support");
+
+    typedef alloc_t					allocator_type;
+    typedef mabit<word_t, alloc_t>			mabit_t;
+    typedef mabitset<word_t, alloc_t>			set_t;
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef mabit_simd<word_t>				simd_t;
+    typedef mabit_montgomery<word_t, alloc_t>		montgomery_t;
+    typedef mabit_barrett<word_t, alloc_t>		barrett_t;
+    typedef mabit_gcd<word_t, alloc_t>			gcd_t;
+    typedef mabit_root<word_t, alloc_t>			root_t;
 
     static const msize_t				MIN_SIZE = sizeof(unsigned long long) / sizeof(word_t);
     static const word_t					WORD_MAX = ~static_cast<word_t>(0);
 
-    mabit() : _sign(true)
+    mabit() : _sign(true), _used(0)
     {
       resize(MIN_SIZE);
     }
 
-    mabit(const mabit_t& other) : _sign(other._sign), _set(other._set)
+    mabit(const mabit_t& other) : _sign(other._sign), _used(other._used), _set(other._set)
     {
     }
 
-    mabit(mabit_t&& other) : _sign(other._sign), _set(std::move(other._set))
+    mabit(mabit_t&& other) : _sign(other._sign), _used(other._used), _set(std::move(other._set))
     {
+      other._sign = true;
+      other._used = 0;
     }
 
-    template<typename word_type>
-    mabit(const word_type val) : _sign(true)
+    template<typename word_type, typename = typename std::enable_if<std::is_integral<word_type>::value>::type>
+    mabit(const word_type val) : _sign(!is_negative(val)), _used(0)
     {
       resize(MIN_SIZE);
+      add(0, magnitude(val), true);
+    }
 
-      if (std::is_signed<word_type>::value && val < 0)
-	{
-	  add(0, -val, true);
-	  negate();
-	}
-      else if (val > 0)
-	{
-	  add(0, val, true);
-	}
+    /**
+     ** \brief
+     ** Evaluates the expression `e` (see mabit_expr.hpp) straight into the new number
+     */
+    template<typename expr_t, typename = typename std::enable_if<is_mabit_expr<expr_t>::value>::type>
+    mabit(const expr_t& e) : _sign(true), _used(0)
+    {
+      e.eval(*this);
     }
 
-    mabit(const std::string& val, const int base = 10)
+    mabit(const std::string& val, const int base = 10) : _used(0)
     {
       from_string(val, base);
     }
 
-    mabit(const char* const val, const int base = 10)
+    mabit(const char* const val, const int base = 10) : _used(0)
     {
       from_string(val, base);
     }
 
+    /**
+     ** \brief
+     ** Reads `src` written in `base`, see mabit_stream::from_string()
+     ** Throws std::invalid_argument for a base out of [2, 36] or a character which is not one of its digits
+     */
     void			from_string(const std::string& src, const int base = 10)
     {
-      clear();
-      resize(MIN_SIZE);
-
-      for (size_t i = src[0] == '-' ? 1 : 0; i < src.length(); ++i)
-	{
-	  char c = src[i];
-
-	  if (c >= '0' && c <= '9')
-	    c -= '0';
-	  else
-	    c = c - 'A' + 10;
-
-	  *this *= base;
-	  *this += c;
-	}
-      if (src[0] == '-')
-	negate();
+      mabit_stream<word_t, alloc_t>::from_string(*this, src, base);
     }
 
     ~mabit()
@@ -99,6 +129,7 @@ namespace Mabit
       if (this != &other)
 	{
 	  _sign = other._sign;
+	  _used = other._used;
 	  _set = other._set;
 	}
       return *this;
@@ -109,191 +140,410 @@ namespace Mabit
       if (this != &other)
 	{
 	  _sign = other._sign;
+	  _used = other._used;
 	  _set = std::move(other._set);
+	  other._sign = true;
+	  other._used = 0;
 	}
       return *this;
     }
 
+    // Expressions are evaluated inside our own words
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator = (const expr_t& e)
+    {
+      e.eval(*this);
+      return *this;
+    }
+
     /************************************************************************/
-    /* COMPARISON OPERATORS  ==  <=  >=  <  >  !=                           */
+    /* COMPARISON OPERATORS  ==  <=  >=  <  >  !=  <=>                      */
     /************************************************************************/
-    bool			operator == (const mabit_t& other) const
+    /**
+     **	\brief
+     ** Compares with `other` in a single top-down pass over the words, returns -1, 0 or 1
+     */
+    int				compare(const mabit_t& other) const
     {
       if (this == &other)
-	return true;
+	return 0;
 
+      // Counting the words settles the sign of a magnitude cleared through operator []
+      used_words();
+      other.used_words();
       if (_sign != other._sign)
-	return false;
+	return _sign ? 1 : -1;
 
-      if (used_words() != other.used_words())
-	return false;
+      // Between negative numbers, the biggest magnitude is the smallest
+      const int			c = cmp_abs(other);
 
-      for (auto i = _set.begin(), j = other._set.begin(); i != _set.end() && j != other._set.end(); ++i, ++j)
-	if (*i != *j)
-	  return false;
+      return _sign ? c : -c;
+    }
 
-      return true;
+    bool			operator == (const mabit_t& other) const
+    {
+      return compare(other) == 0;
     }
 
     bool			operator != (const mabit_t& other) const
     {
-      return !(*this == other);
+      return compare(other) != 0;
     }
 
     bool			operator <= (const mabit_t& other) const
+    {
+      return compare(other) <= 0;
+    }
+
+    bool			operator < (const mabit_t& other) const
+    {
+      return compare(other) < 0;
+    }
+
+    bool			operator >= (const mabit_t& other) const
+    {
+      return compare(other) >= 0;
+    }
+
+    bool			operator > (const mabit_t& other) const
+    {
+      return compare(other) > 0;
+    }
+
+#ifdef MABIT_THREE_WAY_COMPARISON
+    std::strong_ordering	operator <=> (const mabit_t& other) const
+    {
+      return compare(other) <=> 0;
+    }
+#endif
+
+    /************************************************************************/
+    /* ARITHMETIC OPERATORS  +=  -=  *=  /=  %=  ++  --                     */
+    /************************************************************************/
+    // Binary operators build expressions, see mabit_expr.hpp
+    mabit_t&			operator += (const mabit_t& other)
+    {
+      addition(*this, other, true);
+      return *this;
+    }
+
+    mabit_t&			operator ++ ()
+    {
+      return *this += 1;
+    }
+
+    mabit_t&			operator -= (const mabit_t& other)
+    {
+      addition(*this, other, false);
+      return *this;
+    }
+
+    mabit_t&			operator -- ()
+    {
+      return *this -= 1;
+    }
+
+    mabit_t&			operator *= (const mabit_t& other)
     {
       if (this == &other)
-	return true;
+	{
+	  squaring(*this);
+	  return *this;
+	}
 
-      if (_sign && !other._sign)
-	return false;
+      const bool		final_sign = _sign == other._sign;
 
-      if (!_sign && other._sign)
-	return true;
+      multiplication(*this, other);
+      set_sign(final_sign);
+      return *this;
+    }
 
-      msize_t			words = used_words();
-      const msize_t		o_words = other.used_words();
+    mabit_t&			operator /= (const mabit_t& other)
+    {
+      mabit_t			remainder;
 
-      if (!words && !o_words)
-	return true;
+      if (this == &other)
+	{
+	  divmod(other, *this, remainder);
+	  return *this;
+	}
 
-      if ((!_sign && words > o_words) || (_sign && words < o_words))
-	return true;
+      // Divides in place, without a copy of the dividend
+      const bool		final_sign = _sign == other._sign;
 
-      if ((!_sign && words < o_words) || (_sign && words > o_words))
-	return false;
+      division(*this, remainder, other);
+      set_sign(final_sign);
+      return *this;
+    }
 
-      for (--words; words > 0; --words)
+    mabit_t&			operator %= (const mabit_t& other)
+    {
+      if (this == &other)
 	{
-	  if (_set[words] == other._set[words])
-	    continue;
-	  return _set[words] < other._set[words];
+	  mabit_t		quotient;
+
+	  divmod(other, quotient, *this);
+	  return *this;
 	}
-      return _set[0] <= other._set[0];
+
+      // The dividend hands its words over to the quotient
+      const bool		final_sign = _sign;
+      mabit_t			quotient(std::move(*this));
+
+      division(quotient, *this, other);
+      set_sign(final_sign);
+      return *this;
     }
 
-    bool			operator < (const mabit_t& other) const
+    // x += a * b and x -= a * b are fused, see addmul() and submul()
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator += (const expr_t& e)
     {
-      if (*this == other)
-	return false;
-      return *this <= other;
+      mabit_apply(mabit_add_op(), *this, e);
+      return *this;
     }
 
-    bool			operator >= (const mabit_t& other) const
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator -= (const expr_t& e)
     {
-      return !(*this < other);
+      mabit_apply(mabit_sub_op(), *this, e);
+      return *this;
     }
 
-    bool			operator > (const mabit_t& other) const
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator *= (const expr_t& e)
     {
-      return !(*this <= other);
+      mabit_apply(mabit_mul_op(), *this, e);
+      return *this;
     }
 
-    /************************************************************************/
-    /* ARITHMETIC OPERATORS  +=  -=  *=  /=  %=  +  -  *  /  %              */
-    /************************************************************************/
-    mabit_t&			operator += (const mabit_t& other)
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator /= (const expr_t& e)
     {
-      addition(*this, other, true);
+      mabit_apply(mabit_div_op(), *this, e);
       return *this;
     }
 
-    mabit_t			operator + (const mabit_t& other) const
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator %= (const expr_t& e)
     {
-      return mabit_t(*this) += other;
+      mabit_apply(mabit_mod_op(), *this, e);
+      return *this;
     }
 
-    mabit_t&			operator ++ ()
+    /**
+     ** \brief
+     ** Adds the product of `a` and `b` inside our words, see add_product()
+     ** `a` and `b` may be ourself
+     */
+    void			addmul(const mabit_t& a, const mabit_t& b)
+    {
+      add_product(a, b, true);
+    }
+
+    /**
+     ** \brief
+     ** Subtracts the product of `a` and `b` inside our words, see add_product()
+     ** `a` and `b` may be ourself
+     */
+    void			submul(const mabit_t& a, const mabit_t& b)
     {
-      add(0, 1, _sign);
+      add_product(a, b, false);
+    }
+
+    /************************************************************************/
+    /* NATIVE INTEGER OPERATORS  +=  -=  *=  /=  %=  +  -  *  /  %          */
+    /************************************************************************/
+    // Operands fitting a word go through single word kernels, without any temporary mabit
+    // On an expiring mabit they build a node (see mabit_native_expr), which takes over its words once assigned
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t&>::type
+				operator += (const int_type val)
+    {
+      const unsigned long long	mag = magnitude(val);
 
-      if (!_sign && !any())
-	_sign = true;
+      if (mag > WORD_MAX)
+	return *this += mabit_t(val);
 
+      add_word(static_cast<word_t>(mag), !is_negative(val));
       return *this;
     }
 
-    mabit_t&			operator -= (const mabit_t& other)
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t>::type
+				operator + (const int_type val) const &
     {
-      addition(*this, other, false);
-      return *this;
+      mabit_t			ret(*this);
+
+      ret += val;
+      return ret;
     }
 
-    mabit_t			operator - (const mabit_t& other) const
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_native_expr<mabit_add_op, mabit_temp<mabit_t>, int_type> >::type
+				operator + (const int_type val) &&
     {
-      return mabit_t(*this) -= other;
+      return mabit_native_expr<mabit_add_op, mabit_temp<mabit_t>, int_type>(mabit_temp<mabit_t>(*this), val);
     }
 
-    mabit_t&			operator -- ()
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t&>::type
+				operator -= (const int_type val)
     {
-      return *this -= 1;
+      const unsigned long long	mag = magnitude(val);
+
+      if (mag > WORD_MAX)
+	return *this -= mabit_t(val);
+
+      add_word(static_cast<word_t>(mag), is_negative(val));
+      return *this;
     }
 
-    mabit_t&			operator *= (const mabit_t& other)
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t>::type
+				operator - (const int_type val) const &
     {
-      const bool		final_sign = _sign == other._sign;
+      mabit_t			ret(*this);
+
+      ret -= val;
+      return ret;
+    }
+
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_native_expr<mabit_sub_op, mabit_temp<mabit_t>, int_type> >::type
+				operator - (const int_type val) &&
+    {
+      return mabit_native_expr<mabit_sub_op, mabit_temp<mabit_t>, int_type>(mabit_temp<mabit_t>(*this), val);
+    }
 
-      if (!_sign)
-	negate();
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t&>::type
+				operator *= (const int_type val)
+    {
+      const unsigned long long	mag = magnitude(val);
 
-      multiplication(*this, std::forward<mabit_t>(other.abs()));
+      if (mag > WORD_MAX)
+	return *this *= mabit_t(val);
 
-      if (!final_sign)
-	negate();
+      const bool		final_sign = _sign != is_negative(val);
 
+      mul_word(static_cast<word_t>(mag));
+      set_sign(final_sign);
       return *this;
     }
 
-    mabit_t			operator * (const mabit_t& other) const
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t>::type
+				operator * (const int_type val) const &
     {
-      return mabit_t(*this) *= other;
+      mabit_t			ret(*this);
+
+      ret *= val;
+      return ret;
     }
 
-    mabit_t&			operator /= (const mabit_t& other)
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_native_expr<mabit_mul_op, mabit_temp<mabit_t>, int_type> >::type
+				operator * (const int_type val) &&
     {
-      const bool		final_sign = _sign == other._sign;
+      return mabit_native_expr<mabit_mul_op, mabit_temp<mabit_t>, int_type>(mabit_temp<mabit_t>(*this), val);
+    }
 
-      if (!_sign)
-	negate();
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t&>::type
+				operator /= (const int_type val)
+    {
+      const unsigned long long	mag = magnitude(val);
+
+      if (mag > WORD_MAX)
+	return *this /= mabit_t(val);
 
-      division(*this, std::forward<mabit_t>(other.abs()), true);
+      // Like / by 0, the dividend is left untouched
+      if (!mag)
+	return *this;
 
-      if (!final_sign)
-	negate();
+      const bool		final_sign = _sign != is_negative(val);
 
+      divrem_word(static_cast<word_t>(mag));
+      set_sign(final_sign);
       return *this;
     }
 
-    mabit_t			operator / (const mabit_t& other) const
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t>::type
+				operator / (const int_type val) const &
     {
-      return mabit_t(*this) /= other;
+      mabit_t			ret(*this);
+
+      ret /= val;
+      return ret;
     }
 
-    mabit_t&			operator %= (const mabit_t& other)
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_native_expr<mabit_div_op, mabit_temp<mabit_t>, int_type> >::type
+				operator / (const int_type val) &&
+    {
+      return mabit_native_expr<mabit_div_op, mabit_temp<mabit_t>, int_type>(mabit_temp<mabit_t>(*this), val);
+    }
+
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t&>::type
+				operator %= (const int_type val)
     {
-      const bool		final_sign = _sign == other._sign ? _sign : (!_sign ? false : true);
+      const unsigned long long	mag = magnitude(val);
+
+      if (mag > WORD_MAX)
+	return *this %= mabit_t(val);
 
-      if (!_sign)
-	negate();
+      // Like % by 0, the dividend is left untouched
+      if (!mag)
+	return *this;
 
-      division(*this, std::forward<mabit_t>(other.abs()), false);
+      const word_t		rem = divrem_word(static_cast<word_t>(mag));
 
-      if (!final_sign)
-	negate();
+      std::fill(_set.begin(), _set.begin() + used_words(), 0);
+      if (_set.empty())
+	resize(1);
+      _set[0] = rem;
+      _used = rem ? 1 : 0;
 
+      // The remainder takes the sign of the dividend
+      set_sign(_sign);
       return *this;
     }
 
-    mabit_t			operator % (const mabit_t& other) const
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_t>::type
+				operator % (const int_type val) const &
+    {
+      mabit_t			ret(*this);
+
+      ret %= val;
+      return ret;
+    }
+
+    template<typename int_type>
+    typename std::enable_if<std::is_integral<int_type>::value, mabit_native_expr<mabit_mod_op, mabit_temp<mabit_t>, int_type> >::type
+				operator % (const int_type val) &&
     {
-      return mabit_t(*this) %= other;
+      return mabit_native_expr<mabit_mod_op, mabit_temp<mabit_t>, int_type>(mabit_temp<mabit_t>(*this), val);
     }
 
     /************************************************************************/
     /* WORD ACCESS OPERATOR  []                                             */
     /************************************************************************/
+    // Words hold the magnitude, least significant first, the sign being kept apart
+    // The returned word may be written: the next use counts the used words again and drops the sign of a null magnitude
+    // Like any other change, writes should be done before the number is shared between threads
     word_t&			operator [] (const msize_t at)
     {
+      _used = UNKNOWN_USED;
       return _set[at];
     }
 
@@ -303,80 +553,135 @@ namespace Mabit
     }
 
     /************************************************************************/
-    /* BINARY OPERATORS  &=  &  |=  |  ^=  ^  <<=  <<  >>=  >>  ~           */
+    /* BINARY OPERATORS  &=  |=  ^=  <<=  >>=                               */
     /************************************************************************/
+    // Bitwise operators behave as if both operands were stored in two's complement
+    // Non negative operands are combined straight by the vector kernels of mabit_simd
     mabit_t&			operator &= (const mabit_t& other)
     {
-      _set &= other._set;
-      return *this;
-    }
+      if (!_sign || !other._sign)
+	{
+	  bitwise(other, [] (const word_t a, const word_t b) { return static_cast<word_t>(a & b); });
+	  return *this;
+	}
 
-    mabit_t			operator & (const mabit_t& other) const
-    {
-      return mabit_t(*this) &= other;
-    }
+      const msize_t		words = used_words();
+      const msize_t		common = words < other.used_words() ? words : other.used_words();
 
-    mabit_t&			operator |= (const mabit_t& other)
-    {
-      _set |= other._set;
+      widen(other);
+      simd_t::and_n(_set.data(), other._set.data(), common);
+      std::fill(_set.begin() + common, _set.begin() + words, 0);
+      normalize(common);
       return *this;
     }
 
-    mabit_t			operator | (const mabit_t& other) const
+    mabit_t&			operator |= (const mabit_t& other)
     {
-      return mabit_t(*this) |= other;
-    }
+      if (!_sign || !other._sign)
+	{
+	  bitwise(other, [] (const word_t a, const word_t b) { return static_cast<word_t>(a | b); });
+	  return *this;
+	}
 
-    mabit_t&			operator ^= (const mabit_t& other)
-    {
-      _set ^= other._set;
+      const msize_t		words = used_words();
+      const msize_t		o_words = other.used_words();
+
+      widen(other);
+      simd_t::or_n(_set.data(), other._set.data(), o_words);
+      _used = words < o_words ? o_words : words;
       return *this;
     }
 
-    mabit_t			operator ^ (const mabit_t& other) const
+    mabit_t&			operator ^= (const mabit_t& other)
     {
-      return mabit_t(*this) ^= other;
+      if (!_sign || !other._sign)
+	{
+	  bitwise(other, [] (const word_t a, const word_t b) { return static_cast<word_t>(a ^ b); });
+	  return *this;
+	}
+
+      const msize_t		words = used_words();
+      const msize_t		o_words = other.used_words();
+
+      widen(other);
+      simd_t::xor_n(_set.data(), other._set.data(), o_words);
+      normalize(words < o_words ? o_words : words);
+      return *this;
     }
 
-    mabit_t&			operator <<= (const msize_t shift)
+    // x &= ~y is fused, see andnot()
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator &= (const expr_t& e)
     {
-      _set <<= shift;
+      mabit_apply(mabit_and_op(), *this, e);
       return *this;
     }
 
-    mabit_t			operator << (const msize_t shift) const
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator |= (const expr_t& e)
     {
-      return mabit_t(*this) <<= shift;
+      mabit_apply(mabit_or_op(), *this, e);
+      return *this;
     }
 
-    mabit_t&			operator >>= (const msize_t shift)
+    template<typename expr_t>
+    typename std::enable_if<is_mabit_expr<expr_t>::value, mabit_t&>::type
+				operator ^= (const expr_t& e)
     {
-      _set >>= shift;
+      mabit_apply(mabit_xor_op(), *this, e);
       return *this;
     }
 
-    mabit_t			operator >> (const msize_t shift) const
+    /**
+     ** \brief
+     ** Clears the bits set in `other`, i.e. *this &= ~other in a single pass
+     */
+    void			andnot(const mabit_t& other)
     {
-      return mabit_t(*this) >>= shift;
+      if (!_sign || !other._sign)
+	{
+	  bitwise(other, [] (const word_t a, const word_t b) { return static_cast<word_t>(a & ~b); });
+	  return ;
+	}
+
+      const msize_t		words = used_words();
+
+      widen(other);
+      simd_t::andnot_n(_set.data(), other._set.data(), words < other.used_words() ? words : other.used_words());
+      normalize(words);
     }
 
-    mabit_t			operator ~ () const
+    mabit_t&			operator <<= (const msize_t shift)
     {
-      mabit_t			ret(*this);
+      const msize_t		bound = used_words() + shift / _set.BITS_IN_WORD + 1;
 
-      ret.flip();
-      return ret;
+      _set <<= shift;
+      normalize(bound < _set.size() ? bound : _set.size());
+      set_sign(_sign);
+      return *this;
     }
 
-    /************************************************************************/
-    /* UNARY MINUS OPERATOR  -                                              */
-    /************************************************************************/
-    mabit_t			operator - () const
+    mabit_t&			operator >>= (const msize_t shift)
     {
-      mabit_t			ret(*this);
+      const msize_t		words = used_words();
+      const msize_t		block_shift = shift / _set.BITS_IN_WORD;
+      const msize_t		bound = words > block_shift ? words - block_shift : 0;
 
-      ret.negate();
-      return ret;
+      if (_sign)
+	{
+	  _set >>= shift;
+	  normalize(bound);
+	  return *this;
+	}
+
+      // Negative numbers round toward minus infinity, like an arithmetic shift: -((|x| - 1) >> shift) - 1
+      kernel_t::sub_1(_set.data(), _set.data(), words, 1);
+      _set >>= shift;
+      normalize(bound);
+      add_word(1, false);
+      return *this;
     }
 
     template<typename word_out>
@@ -384,15 +689,17 @@ namespace Mabit
     {
       const msize_t		bits = used_bits();
 
-      if ((_sign && !any()) || bits > sizeof(word_out) * 8)
+      if (!bits || bits > sizeof(word_out) * 8)
 	return 0;
 
       word_out			ret = 0;
 
       for (msize_t i = word_ceil(bits); i > 0; --i)
 	{
-	  ret <<= _set.BITS_IN_WORD;
-	  ret |= simulate_abs(i - 1);
+	  // Never shifts by the full width of `word_out`: such a word can only be the last one
+	  if (sizeof(word_t) < sizeof(word_out))
+	    ret <<= _set.BITS_IN_WORD % (sizeof(word_out) * 8);
+	  ret |= _set[i - 1];
 	}
 
       if (!_sign && std::is_signed<word_out>::value)
@@ -453,6 +760,8 @@ namespace Mabit
     void			turn_bits(const bool val)
     {
       _set.fill(val ? WORD_MAX : 0);
+      _used = val ? _set.size() : 0;
+      set_sign(_sign);
     }
 
     bool			get_bit(const msize_t bit) const
@@ -460,7 +769,7 @@ namespace Mabit
       if (bit >= _set.size() * _set.BITS_IN_WORD)
 	return false;
 
-      return (_set[bit / _set.BITS_IN_WORD] & (1UL << (bit % _set.BITS_IN_WORD))) != 0;
+      return (_set[bit / _set.BITS_IN_WORD] & (static_cast<word_t>(1) << (bit % _set.BITS_IN_WORD))) != 0;
     }
 
     void			set_bit(const msize_t bit, const bool val)
@@ -468,88 +777,194 @@ namespace Mabit
       if (bit >= _set.size() * _set.BITS_IN_WORD)
 	return ;
 
+      const msize_t		word = bit / _set.BITS_IN_WORD;
+      const msize_t		words = used_words();
+
       if (val)
-	// Turns bit on
-	_set[bit / _set.BITS_IN_WORD] |= (1UL << (bit % _set.BITS_IN_WORD));
+	{
+	  // Turns bit on
+	  _set[word] |= (static_cast<word_t>(1) << (bit % _set.BITS_IN_WORD));
+	  _used = word < words ? words : word + 1;
+	}
       else
-	// Turns bit off
-	_set[bit / _set.BITS_IN_WORD] &= ~(1UL << (bit % _set.BITS_IN_WORD));
+	{
+	  // Turns bit off
+	  _set[word] &= ~(static_cast<word_t>(1) << (bit % _set.BITS_IN_WORD));
+	  normalize(words);
+	  set_sign(_sign);
+	}
     }
 
     bool			get_bit(const word_t word, const msize_t pos) const
     {
-      return (word & (1UL << pos)) != 0;
+      return (word & (static_cast<word_t>(1) << pos)) != 0;
     }
 
-    void			flip()
+    /************************************************************************/
+    /* BIT QUERIES                                                          */
+    /************************************************************************/
+    // Like get_bit() and set_bit(), queries look at the magnitude, bit indexes going up to size() words
+    msize_t			popcount() const
     {
-      _set.flip();
+      return simd_t::popcount(_set.data(), used_words());
     }
 
-    void			clear()
+    /**
+     ** \brief
+     ** Returns the number of zero bits above the magnitude, within size() words
+     */
+    msize_t			count_leading_zeros() const
     {
-      _sign = true;
-      _set.fill(0);
+      return _set.size() * _set.BITS_IN_WORD - used_bits();
     }
 
-    void			resize(const msize_t size)
+    /**
+     ** \brief
+     ** Returns the index of the lowest bit set, size() words worth of bits for 0
+     */
+    msize_t			count_trailing_zeros() const
     {
-      _set.resize(size, _sign ? 0 : WORD_MAX);
+      return find_next_set(0);
     }
 
-    msize_t			size() const
+    /**
+     ** \brief
+     ** Returns the index of the lowest bit set from `pos` onward, size() words worth of bits if there is none
+     */
+    msize_t			find_next_set(const msize_t pos) const
     {
-      return _set.size();
-    }
+      const msize_t		words = used_words();
+      msize_t			word = pos / _set.BITS_IN_WORD;
 
-    void			negate()
-    {
-      if (!any())
+      if (word >= words)
+	return _set.size() * _set.BITS_IN_WORD;
+
+      // Bits below `pos` are masked out of its word
+      word_t			w = _set[word] & static_cast<word_t>(WORD_MAX << (pos % _set.BITS_IN_WORD));
+
+      while (!w)
 	{
-	  _sign = true;
-	  return ;
+	  if (++word == words)
+	    return _set.size() * _set.BITS_IN_WORD;
+	  w = _set[word];
 	}
+      return word * _set.BITS_IN_WORD + kernel_t::ctz(w);
+    }
 
-      _sign = !_sign;
-      flip();
-      add(0, 1);
+    /**
+     ** \brief
+     ** Turns the bits [lo, hi) on, bits past size() words are left out like with set_bit()
+     */
+    void			set_range(const msize_t lo, const msize_t hi)
+    {
+      turn_range(lo, hi, true);
+    }
 
-      if (!_sign && !get_bit(_set.size() * _set.BITS_IN_WORD - 1))
-	resize(_set.size() + 1);
+    void			clear_range(const msize_t lo, const msize_t hi)
+    {
+      turn_range(lo, hi, false);
     }
 
-    bool			is_power_of_2() const
+    /**
+     ** \brief
+     ** Returns the bits [lo, hi) of the magnitude, shifted down to bit 0
+     */
+    mabit_t			extract_bits(const msize_t lo, const msize_t hi) const
     {
-      msize_t			words = used_words();
+      const msize_t		bits = used_bits();
+      const msize_t		top = hi < bits ? hi : bits;
+      mabit_t			ret;
+
+      if (lo >= top)
+	return ret;
+
+      const msize_t		first = lo / _set.BITS_IN_WORD;
+      const msize_t		words = word_ceil(top) - first;
+      const msize_t		kept = word_ceil(top - lo);
+
+      ret.resize(words);
+      std::copy(_set.begin() + first, _set.begin() + first + words, ret._set.begin());
+      if (lo % _set.BITS_IN_WORD)
+	kernel_t::rshift(ret._set.data(), ret._set.data(), words, lo % _set.BITS_IN_WORD);
+
+      // Clears what was above `top`
+      if ((top - lo) % _set.BITS_IN_WORD)
+	ret._set[kept - 1] &= static_cast<word_t>(WORD_MAX >> (_set.BITS_IN_WORD - (top - lo) % _set.BITS_IN_WORD));
+      std::fill(ret._set.begin() + kept, ret._set.begin() + words, 0);
+      ret.normalize(kept);
+      return ret;
+    }
 
-      if (!words)
-	return false;
+    /**
+     ** \brief
+     ** Returns the number of bits which differ between the magnitudes of ourself and `other`
+     */
+    msize_t			hamming_distance(const mabit_t& other) const
+    {
+      const msize_t		words = used_words();
+      const msize_t		o_words = other.used_words();
+      const mabit_t&		longer = words < o_words ? other : *this;
+      const msize_t		common = words < o_words ? words : o_words;
 
-      const word_t		w = _set[words - 1];
+      return simd_t::hamming(_set.data(), other._set.data(), common)
+	+ simd_t::popcount(longer._set.data() + common, longer.used_words() - common);
+    }
 
-      // Word: WORD_MAX OR POWER_OF_TWO
-      if (w == WORD_MAX || (_sign && !(w & (w - 1)))
-	  || (!_sign && !static_cast<word_t>((~w + 1) & ((~w + 1) - 1))))
-	{
-	  if (words == 1)
-	    return w != WORD_MAX;
+    void			flip()
+    {
+      _set.flip();
+      normalize(_set.size());
+      set_sign(_sign);
+    }
 
-	  words -= 2;
+    void			clear()
+    {
+      _sign = true;
+      std::fill(_set.begin(), _set.begin() + used_words(), 0);
+      _used = 0;
+    }
+
+    void			resize(const msize_t size)
+    {
+      const msize_t		words = used_words();
 
-	  for (; words > 0 && !_set[words]; --words) ;
+      _set.resize(size, 0);
 
-	  if (!words && !_set[0])
-	    return true;
+      // Only dropping significant words changes the count
+      if (size < words)
+	{
+	  normalize(size);
+	  set_sign(_sign);
 	}
-      return false;
+      else
+	_used = words;
+    }
+
+    msize_t			size() const
+    {
+      return _set.size();
+    }
+
+    void			negate()
+    {
+      // Only the sign changes, zero stays positive
+      set_sign(!_sign);
+    }
+
+    /**
+     ** \brief
+     ** Returns whether the magnitude is a power of 2
+     */
+    bool			is_power_of_2() const
+    {
+      const msize_t		words = used_words();
+
+      return words && kernel_t::popcount(_set[words - 1]) == 1 && count_trailing_zeros() == used_bits() - 1;
     }
 
     bool			any() const
     {
-      for (auto i : _set)
-	if (i != 0)
-	  return true;
-      return false;
+      return used_words() != 0;
     }
 
     bool			all() const
@@ -560,94 +975,193 @@ namespace Mabit
       return true;
     }
 
-    mabit_t			abs() const
+    mabit_t			abs() const &
+    {
+      mabit_t			ret(*this);
+
+      ret._sign = true;
+      return ret;
+    }
+
+    mabit_unary_expr<mabit_abs_op, mabit_temp<mabit_t> >	abs() &&
     {
-      return _sign ? *this : -*this;
+      return mabit_unary_expr<mabit_abs_op, mabit_temp<mabit_t> >(mabit_temp<mabit_t>(*this));
     }
 
     /**
      ** \brief
-     ** Returns the number of representative words
+     ** Returns the square of the value, faster than a multiplication by itself
      */
-    msize_t			used_words() const
+    mabit_t			square() const
     {
-      msize_t			ret = _set.size();
+      mabit_t			ret(*this);
 
-      for (auto i = _set.rbegin(); i != _set.rend() && ret > 0; ++i, --ret)
-	if ((_sign && *i != 0) || (!_sign && *i != WORD_MAX))
-	  break ;
+      squaring(ret);
+      return ret;
+    }
 
-      if (!_sign)
-	{
-	  // Make ret an index for _set
-	  if (ret)
-	    --ret;
+    /**
+     ** \brief
+     ** Returns *this ^ exp mod |mod|, in [0, |mod|)
+     ** Odd moduli go through Montgomery multiplication (see mabit_montgomery), even ones through Barrett reduction (see mabit_barrett)
+     ** A negative exponent raises the inverse (see invmod()), 0 being returned when there is none
+     ** Like % by 0, a null modulus gives the value back
+     */
+    mabit_t			powmod(const mabit_t& exp, const mabit_t& mod) const
+    {
+      const msize_t		n = mod.used_words();
 
-	  // If last bit equals 0 then add 1 to the final result
-	  if (!get_bit(_set[ret], _set.BITS_IN_WORD - 1))
-	    ++ret;
+      if (!n)
+	return *this;
+
+      mabit_t			ret;
+
+      ret.resize(n < MIN_SIZE ? MIN_SIZE : n);
+      if (exp.any() && !exp._sign)
+	{
+	  mabit_t		inverse;
 
-	  // transform index to real number
-	  ++ret;
+	  return invmod(mod, inverse) ? inverse.powmod(exp.abs(), mod) : ret;
 	}
+
+      if (mod._set[0] & 1)
+	exponentiation(ret, montgomery_t(mod._set.data(), n), exp);
+      else
+	exponentiation(ret, barrett_t(mod._set.data(), n), exp);
       return ret;
     }
 
     /**
      ** \brief
-     ** Returns the number of representative bits
+     ** Returns the greatest common divisor of the magnitudes, 0 only if both are null
+     ** Binary gcd on two words, Lehmer's algorithm above and a half gcd from MABIT_GCD_DC_THRESHOLD words, see mabit_gcd
      */
-    msize_t			used_bits() const
+    mabit_t			gcd(const mabit_t& other) const
     {
-      msize_t			bit = used_words() * _set.BITS_IN_WORD;
+      return gcd_t::gcd(*this, other);
+    }
 
-      if (!bit)
-	return 0;
+    /**
+     ** \brief
+     ** Returns the least common multiple of the magnitudes, 0 if either is null
+     */
+    mabit_t			lcm(const mabit_t& other) const
+    {
+      if (!any() || !other.any())
+	return mabit_t();
+
+      mabit_t			ret = abs();
+
+      ret /= gcd(other);
+      ret *= other;
+      ret._sign = true;
+      return ret;
+    }
 
-      --bit;
+    /**
+     ** \brief
+     ** Returns g = gcd(*this, other) and stores inside `s` and `t` cofactors such that g = s * *this + t * other
+     ** |s| <= |other| / g and |t| <= |*this| / g
+     */
+    mabit_t			gcdext(const mabit_t& other, mabit_t& s, mabit_t& t) const
+    {
+      return gcd_t::gcdext(*this, other, s, t);
+    }
 
-      for (; bit > 0; --bit)
-	if ((_sign && get_bit(bit))
-	    || (!_sign && !get_bit(bit)))
-	  break;
+    /**
+     ** \brief
+     ** Stores inside `inverse` the inverse of the value modulo |mod|, in [0, |mod|)
+     ** Returns false, leaving `inverse` untouched, if the value and the modulus are not coprime
+     */
+    bool			invmod(const mabit_t& mod, mabit_t& inverse) const
+    {
+      const mabit_t		m = mod.abs();
+      mabit_t			s;
+      mabit_t			t;
 
-      if (!_sign && is_power_of_2())
-	++bit;
+      if (!m.any() || gcd_t::gcdext(*this % m, m, s, t) != mabit_t(1))
+	return false;
 
-      return ++bit;
+      // s is in (-|mod|, |mod|)
+      if (!s._sign)
+	s += m;
+      inverse = std::move(s);
+      return true;
     }
 
     /**
      ** \brief
-     ** Returns the absolute value at position `at`
-     ** If mabit is positive, it just returns the value stored at `at`
-     ** If negative, it calculates the value as if mabit were positive
+     ** Computes both the quotient and the remainder of the division by `other` in a single pass
+     ** The quotient is truncated toward zero and the remainder takes the sign of the dividend, like / and %
+     ** `quotient` and `remainder` may be the operands
      */
-    word_t			simulate_abs(const msize_t at) const
+    void			divmod(const mabit_t& other, mabit_t& quotient, mabit_t& remainder) const
     {
-      if (_sign)
-	return _set[at];
-      return simulate_opposite(at);
+      const bool		q_sign = _sign == other._sign;
+      const bool		r_sign = _sign;
+      mabit_t			q(*this);
+      mabit_t			r;
+
+      division(q, r, other);
+
+      q.set_sign(q_sign);
+      r.set_sign(r_sign);
+
+      quotient = std::move(q);
+      remainder = std::move(r);
     }
 
     /**
-     **	\brief
-     ** Returns the value at position `at` of the bitset if mabit were the opposite of itself
+     ** \brief
+     ** Divides by the single word `divisor`, stores the quotient inside `quotient` and returns the remainder
+     ** The returned word is the absolute value of the remainder, which takes the sign of the dividend
+     ** `quotient` may be the dividend
      */
-    word_t                      simulate_opposite(const msize_t at) const
+    word_t			divmod(const word_t divisor, mabit_t& quotient) const
     {
-      unsigned long long        tmp = 1;
+      mabit_t			q(*this);
+      const msize_t		words = q.used_words();
+      word_t			r = 0;
 
-      for (msize_t i = 0; i < at; ++i)
+      // Like / by 0, the quotient is left to the dividend
+      if (words && divisor)
 	{
-	  tmp += static_cast<word_t>(~_set[i]);
+	  r = kernel_t::divrem_1(q._set.data(), q._set.data(), words, divisor);
+	  q.normalize(words);
+	}
 
-	  if (tmp <= WORD_MAX)
-	    return ~_set[at];
+      q.set_sign(_sign);
 
-	  tmp >>= _set.BITS_IN_WORD;
+      quotient = std::move(q);
+      return r;
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of words of the magnitude, kept up to date by every change
+     */
+    msize_t			used_words() const
+    {
+      // Words handed out by operator [] may have been changed behind our back, they are counted once
+      if (_used == UNKNOWN_USED)
+	{
+	  _used = kernel_t::normalize(_set.data(), _set.size());
+	  _sign = _sign || !_used;
 	}
-      return tmp += static_cast<word_t>(~_set[at]);
+      return _used;
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of bits of the magnitude
+     */
+    msize_t			used_bits() const
+    {
+      const msize_t		words = used_words();
+
+      if (!words)
+	return 0;
+      return words * _set.BITS_IN_WORD - kernel_t::clz(_set[words - 1]);
     }
 
     mabit_t&			operator << (std::istream& in)
@@ -688,6 +1202,7 @@ namespace Mabit
 	    }
 	  length -= buf_size;
 	}
+      normalize(_set.size());
       return *this;
     }
 
@@ -727,108 +1242,309 @@ namespace Mabit
      ** \param val  : the value to be added
      ** \param auto_resize : indicates whether or not it should resize mabit to store everything
      */
-    void			add(msize_t from, unsigned long long val, bool auto_resize = false)
+    void			add(msize_t from, dword_t val, bool auto_resize = false)
     {
-      if (!val)
+      // A double word spans at most this many words
+      word_t			v[sizeof(dword_t) / sizeof(word_t)];
+      msize_t			n = 0;
+
+      for (; val; val >>= _set.BITS_IN_WORD)
+	v[n++] = static_cast<word_t>(val);
+
+      if (!n)
 	return ;
 
-      word_t			tmp;
+      if (auto_resize && _set.size() < from + n)
+	resize(from + n);
 
-      for (auto i = _set.begin() + from; i != _set.end(); ++i)
-	{
-	  if (*i + val <= WORD_MAX)
-	    {
-	      *i += static_cast<word_t>(val);
-	      val = 0;
-	      break ;
-	    }
-	  tmp = *i;
-	  *i = (tmp + val) & WORD_MAX;
-	  val = (tmp + val) >> _set.BITS_IN_WORD;
-	}
-      if (val > 0 && auto_resize)
-	{
-	  from = _set.size();
-	  resize(from + MIN_SIZE);
-	  add(from, val, true);
-	}
+      // Words which do not fit are left out
+      if (from >= _set.size())
+	return ;
+
+      const msize_t		words = used_words();
+      const msize_t		size = _set.size() - from;
+      const msize_t		fit = n < size ? n : size;
+      const word_t		carry = kernel_t::add(_set.data() + from, _set.data() + from, size, v, fit);
+      const msize_t		bound = (words < from + fit ? from + fit : words) + 1;
+
+      if (carry && auto_resize)
+	_set.push_back(carry);
+      normalize(bound < _set.size() ? bound : _set.size());
     }
-    
+
+    /**
+     ** \brief
+     ** Returns the square root of the magnitude, rounded down
+     */
     mabit_t			isqrt() const
     {
-      mabit_t			rem, root, tmp(*this);
+      return root_t::root(*this, 2);
+    }
+
+    /**
+     ** \brief
+     ** Stores inside `root` the square root of the magnitude and inside `remainder` what is left of it: root^2 + remainder = |*this|
+     ** Zimmermann's Karatsuba square root, see mabit_root
+     ** `root` and `remainder` may be the value
+     */
+    void			sqrtrem(mabit_t& root, mabit_t& remainder) const
+    {
+      mabit_t			s;
+      mabit_t			r;
+
+      root_t::sqrtrem(*this, s, r);
+      root = std::move(s);
+      remainder = std::move(r);
+    }
+
+    /**
+     ** \brief
+     ** Returns the n-th root, truncated toward zero: odd roots of negative numbers are negative, even ones are taken on the magnitude
+     ** Like / by 0, a null `n` gives the value back
+     */
+    mabit_t			iroot(const msize_t n) const
+    {
+      if (!n)
+	return *this;
+
+      mabit_t			ret = root_t::root(*this, n);
+
+      if (!_sign && (n & 1))
+	ret.negate();
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns whether the value is the square of an integer, residues modulo 8 and 2^48 - 1 ruling out most of the others
+     */
+    bool			is_perfect_square() const
+    {
+      return root_t::is_square(*this);
+    }
+
+    /**
+     ** \brief
+     ** Returns whether the value is x^k for some integers x and k >= 2, like 0, 1 and -1
+     ** Each prime exponent goes through residue filters and a 2-adic root before any power is worked out
+     */
+    bool			is_perfect_power() const
+    {
+      return root_t::is_power(*this);
+    }
+
+  private:
+    // Marks a count of used words to be worked out again, see operator []
+    static const msize_t	UNKNOWN_USED = ~static_cast<msize_t>(0);
+
+    // Both may be settled by a const call after writes through operator []
+    mutable bool		_sign;
+    mutable msize_t		_used;
+    set_t			_set;
+
+    friend class		mabit_stream<word_t, alloc_t>;
+    friend class		mabit_modulus<word_t, alloc_t>;
+    friend class		mabit_gcd<word_t, alloc_t>;
+    friend class		mabit_root<word_t, alloc_t>;
+
+    template<typename int_type>
+    static bool			is_negative(const int_type val)
+    {
+      return std::is_signed<int_type>::value && val < 0;
+    }
+
+    /**
+     **	\brief
+     ** Returns the absolute value of `val`
+     */
+    template<typename int_type>
+    static unsigned long long	magnitude(const int_type val)
+    {
+      return is_negative(val) ? 0ULL - static_cast<unsigned long long>(val) : static_cast<unsigned long long>(val);
+    }
+
+    /**
+     **	\brief
+     ** Sets the sign, zero always being positive
+     */
+    void			set_sign(const bool sign)
+    {
+      _sign = sign || !any();
+    }
+
+    /**
+     **	\brief
+     ** Counts the used words again, those from `bound` being known to be null
+     */
+    void			normalize(const msize_t bound)
+    {
+      _used = kernel_t::normalize(_set.data(), bound);
+    }
+
+    /**
+     **	\brief
+     ** Compares the magnitudes, returns a negative, null or positive value like mabit_kernel::cmp()
+     */
+    int				cmp_abs(const mabit_t& other) const
+    {
+      const msize_t		words = used_words();
+      const msize_t		o_words = other.used_words();
+
+      if (words != o_words)
+	return words < o_words ? -1 : 1;
+      return kernel_t::cmp(_set.data(), other._set.data(), words);
+    }
+
+    /**
+     **	\brief
+     ** Adds the word `w` of sign `w_sign` in a single pass
+     */
+    void			add_word(const word_t w, const bool w_sign)
+    {
       const msize_t		words = used_words();
-      const msize_t		ceilb = words * _set.BITS_IN_WORD / 2;
 
-      for (msize_t i = 0; i < ceilb; ++i)
+      if (!w)
+	return ;
+
+      if (!words)
 	{
-	  tmp.resize(words);
-	  rem.resize(words);
-	  root.resize(words);
+	  if (_set.empty())
+	    resize(1);
+	  _set[0] = w;
+	  _used = 1;
+	  _sign = w_sign;
+	  return ;
+	}
 
-	  root <<= 1;
-	  rem <<= 2;
-	  rem += (tmp >> (ceilb * 2 - 2));
-	  tmp <<= 2;
-	  ++root;
+      if (_sign == w_sign)
+	{
+	  const word_t		carry = kernel_t::add_1(_set.data(), _set.data(), words, w);
 
-	  if (root <= rem)
+	  if (carry)
 	    {
-	      rem -= root;
-	      ++root;
+	      if (words == _set.size())
+		_set.push_back(carry);
+	      else
+		_set[words] = carry;
+	      _used = words + 1;
 	    }
-	  else
-	    --root;
+	  return ;
 	}
-      return root >>= 1;
+
+      // Opposite signs, the magnitudes get subtracted
+      if (words == 1 && _set[0] < w)
+	{
+	  // The result takes the sign of `w`
+	  _set[0] = w - _set[0];
+	  _sign = w_sign;
+	  return ;
+	}
+
+      kernel_t::sub_1(_set.data(), _set.data(), words, w);
+      normalize(words);
+      set_sign(_sign);
     }
 
-  private:
-    bool			_sign;
-    set_t			_set;
+    /**
+     **	\brief
+     ** Multiplies the magnitude by the word `w` in a single pass
+     */
+    void			mul_word(const word_t w)
+    {
+      const msize_t		words = used_words();
+      const word_t		carry = kernel_t::mul_1(_set.data(), _set.data(), words, w);
 
-    friend class		mabit_stream<word_t>;
+      if (!carry)
+	{
+	  normalize(words);
+	  return ;
+	}
+
+      if (words == _set.size())
+	_set.push_back(carry);
+      else
+	_set[words] = carry;
+      _used = words + 1;
+    }
 
     /**
      **	\brief
-     ** Returns the sign after the addition of ourself with `other`
-     */
-    bool			sign_add(const mabit_t& a, const mabit_t& b, const bool add_or_sub) const
-    {
-      // (+ + +) OR (- + -)
-      if (add_or_sub && a._sign == b._sign)
-	return a._sign;
-      // (+ - -)
-      if (!add_or_sub && a._sign && !b._sign)
-	return true;
-      // (- - +)
-      if (!add_or_sub && !a._sign && b._sign)
-	return false;
+     ** Divides the magnitude by the word `w` in a single pass, returns the remainder
+     ** A null `w` leaves the number untouched
+     */
+    word_t			divrem_word(const word_t w)
+    {
+      const msize_t		words = used_words();
 
-      const msize_t		a_bits = a.used_bits();
-      const msize_t		b_bits = b.used_bits();
+      if (!words || !w)
+	return 0;
 
-      if (!a_bits && !b_bits)
-	return true;
+      const word_t		r = kernel_t::divrem_1(_set.data(), _set.data(), words, w);
 
-      if (a_bits > b_bits)
-	return a._sign;
+      normalize(words);
+      return r;
+    }
 
-      if (a_bits < b_bits)
-	return add_or_sub ? b._sign : !b._sign;
+    /**
+     **	\brief
+     ** Adds (or subtracts) the product of `a` and `b`, read before we change
+     ** When the magnitudes add and the smallest operand is below the Karatsuba threshold, the rows of the product
+     ** are accumulated in our words. Otherwise the product is made in one scratch buffer, added to our words in place
+     */
+    void			add_product(const mabit_t& a, const mabit_t& b, const bool add_or_sub)
+    {
+      msize_t			an = a.used_words();
+      msize_t			bn = b.used_words();
+
+      if (!an || !bn)
+	return ;
 
-      for (msize_t i = word_ceil(a_bits); i > 0; --i)
+      // Sign of the product actually added
+      const bool		p_sign = add_or_sub == (a._sign == b._sign);
+      const msize_t		words = used_words();
+      const word_t*		ap = a._set.data();
+      const word_t*		bp = b._set.data();
+
+      if (an < bn)
 	{
-	  const word_t		a_abs = a.simulate_abs(i - 1);
-	  const word_t		b_abs = b.simulate_abs(i - 1);
+	  std::swap(an, bn);
+	  std::swap(ap, bp);
+	}
 
-	  if (a_abs > b_abs)
-	    return a._sign;
+      if ((_sign == p_sign || !words) && bn < kernel_t::KARATSUBA_THRESHOLD && &a != this && &b != this)
+	{
+	  // Neither the sum nor any partial one overflows n words
+	  const msize_t		n = (words < an + bn ? an + bn : words) + 1;
+
+	  if (_set.size() < n)
+	    _set.resize(n, 0);
+
+	  word_t* const		r = _set.data();
 
-	  if (a_abs < b_abs)
-	    return add_or_sub ? b._sign : !b._sign;
+	  std::fill(r + words, r + n, 0);
+	  for (msize_t i = 0; i < bn; ++i)
+	    {
+	      word_t		carry = kernel_t::addmul_1(r + i, ap, an, bp[i]);
+
+	      for (msize_t k = i + an; carry; ++k)
+		{
+		  r[k] += carry;
+		  carry = r[k] < carry;
+		}
+	    }
+	  normalize(n);
+	  _sign = p_sign;
+	  resize(_used);
+	  return ;
 	}
-      return true;
+
+      typename kernel_t::scratch_t	product(an + bn);
+
+      if (ap == bp && an == bn)
+	kernel_t::sqr(product.data(), ap, an);
+      else
+	kernel_t::mul(product.data(), ap, an, bp, bn);
+      add_words(product.data(), kernel_t::normalize(product.data(), an + bn), p_sign);
     }
 
     /**
@@ -837,60 +1553,186 @@ namespace Mabit
      */
     void			addition(mabit_t& result, const mabit_t& other, const bool add_or_sub) const
     {
-      if (result == other)
+      const msize_t		o_words = other.used_words();
+
+      if (!o_words)
+	return ;
+
+      // x += x reads its own words, which must not move while add_words() works
+      if (&other == &result)
 	{
-	  if (add_or_sub)
-	    {
-	      result.resize(result.word_ceil(result.used_bits() + 1));
+	  const msize_t		words = o_words + 1;
 
-	      if (!result._sign)
-		{
-		  result.negate();		  
-		  result <<= 1;
-		  result.negate();
-		}
-	      else
-		result <<= 1;
-	    }
+	  if (result._set.size() < words)
+	    result._set.resize(words, 0);
+	}
+      result.add_words(other._set.data(), o_words, add_or_sub == other._sign);
+    }
+
+    /**
+     **	\brief
+     ** Adds the magnitude o[0, o_words) with the sign `o_sign`, o_words > 0
+     ** Same signs add the magnitudes, opposite ones subtract the smallest magnitude from the biggest
+     ** `o` may be our own words only if they already hold one more word than the biggest operand
+     */
+    void			add_words(const word_t* const o, const msize_t o_words, const bool o_sign)
+    {
+      const msize_t		r_words = used_words();
+
+      if (_sign == o_sign || !r_words)
+	{
+	  const msize_t		words = (r_words < o_words ? o_words : r_words) + 1;
+
+	  if (_set.size() < words)
+	    _set.resize(words, 0);
+
+	  word_t* const		r = _set.data();
+
+	  if (r_words >= o_words)
+	    r[words - 1] = kernel_t::add(r, r, r_words, o, o_words);
 	  else
-	    result.clear();
-	  return ;
+	    r[words - 1] = kernel_t::add(r, o, o_words, r, r_words);
+	  normalize(words);
+	  _sign = o_sign;
 	}
+      else if (r_words > o_words || (r_words == o_words && kernel_t::cmp(_set.data(), o, o_words) >= 0))
+	{
+	  word_t* const		r = _set.data();
 
-      const msize_t		o_bits = other.used_bits();
+	  kernel_t::sub(r, r, r_words, o, o_words);
+	  normalize(r_words);
+	}
+      else
+	{
+	  if (_set.size() < o_words)
+	    _set.resize(o_words, 0);
+
+	  word_t* const		r = _set.data();
+
+	  kernel_t::sub(r, o, o_words, r, r_words);
+	  normalize(o_words);
+	  _sign = o_sign;
+	}
 
-      if (!o_bits)
+      resize(_used);
+      set_sign(_sign);
+    }
+
+    /**
+     **	\brief
+     ** Turns the bits [lo, hi) on or off, whole words at once
+     */
+    void			turn_range(const msize_t lo, msize_t hi, const bool val)
+    {
+      const msize_t		bits = _set.size() * _set.BITS_IN_WORD;
+
+      if (hi > bits)
+	hi = bits;
+      if (lo >= hi)
 	return ;
 
-      const msize_t		r_bits = result.used_bits();
-      const msize_t		o_words = word_ceil(o_bits);
-      msize_t			r_words = word_ceil(r_bits);
-      msize_t			i = 0;
+      const msize_t		words = used_words();
+      const msize_t		first = lo / _set.BITS_IN_WORD;
+      const msize_t		last = (hi - 1) / _set.BITS_IN_WORD;
+      // Bits from `lo` in the first word, below `hi` in the last one
+      const word_t		low_mask = static_cast<word_t>(WORD_MAX << (lo % _set.BITS_IN_WORD));
+      const word_t		high_mask = static_cast<word_t>(WORD_MAX >> (_set.BITS_IN_WORD - 1 - (hi - 1) % _set.BITS_IN_WORD));
+
+      if (first == last)
+	turn_word(first, low_mask & high_mask, val);
+      else
+	{
+	  turn_word(first, low_mask, val);
+	  simd_t::fill_n(_set.data() + first + 1, last - first - 1, val ? WORD_MAX : 0);
+	  turn_word(last, high_mask, val);
+	}
 
-      result.resize(result.word_ceil(std::max(r_bits, o_bits) + 1));
+      if (val)
+	_used = words < last + 1 ? last + 1 : words;
+      else
+	{
+	  normalize(words);
+	  set_sign(_sign);
+	}
+    }
+
+    void			turn_word(const msize_t at, const word_t mask, const bool val)
+    {
+      if (val)
+	_set[at] |= mask;
+      else
+	_set[at] &= static_cast<word_t>(~mask);
+    }
+
+    /**
+     **	\brief
+     ** Grows to the size of `other`, like bitwise() does
+     */
+    void			widen(const mabit_t& other)
+    {
+      if (_set.size() < other._set.size())
+	resize(other._set.size());
+    }
 
-      result._sign = sign_add(*this, other, add_or_sub);
+    /**
+     **	\brief
+     ** Combines `f` over the words of the two's complement of ourself and `other`, stores the result inside ourself
+     ** Negative operands are complemented on the fly, the result is turned back into sign and magnitude
+     */
+    template<typename Function>
+    void			bitwise(const mabit_t& other, Function f)
+    {
+      // The signs are read below, a magnitude cleared through operator [] has to be positive first
+      used_words();
+      other.used_words();
+
+      const msize_t		size = _set.size() < other._set.size() ? other._set.size() : _set.size();
+      const word_t		a_ext = _sign ? 0 : WORD_MAX;
+      const word_t		b_ext = other._sign ? 0 : WORD_MAX;
+      const bool		negative = (f(a_ext, b_ext) & 1) != 0;
+      // Carries of the +1 in ~x + 1, for both operands and for the result
+      word_t			a_carry = !_sign;
+      word_t			b_carry = !other._sign;
+      word_t			r_carry = negative;
+      set_t			r;
+
+      // One more word holds the sign extension, so that the magnitude of the result always fits
+      r.resize(size + 1);
+
+      for (msize_t i = 0; i <= size; ++i)
+	{
+	  word_t		a = i < _set.size() ? _set[i] : 0;
+	  word_t		b = i < other._set.size() ? other._set[i] : 0;
 
-      for (; i < o_words; ++i)
-	result.add(i, add_or_sub ? other._set[i] : other.simulate_opposite(i));
+	  a = static_cast<word_t>((a ^ a_ext) + a_carry);
+	  a_carry = a_carry && !a;
+	  b = static_cast<word_t>((b ^ b_ext) + b_carry);
+	  b_carry = b_carry && !b;
 
-      if (((add_or_sub && !other._sign) || (!add_or_sub && other._sign)) && o_words < result._set.size())
-	for (; i < result._set.size(); ++i)
-	  result.add(i, WORD_MAX);
+	  word_t		w = f(a, b);
 
-      r_words = result.used_words();
+	  if (negative)
+	    {
+	      w = static_cast<word_t>(~w + r_carry);
+	      r_carry = r_carry && !w;
+	    }
+	  r[i] = w;
+	}
 
-      if (!r_words)
-	result._sign = true;
+      if (!r[size])
+	r.pop_back();
 
-      result.resize(r_words);
+      _set = std::move(r);
+      normalize(_set.size());
+      set_sign(!negative);
     }
 
     /**
      **	\brief
-     ** Performs the multiplication of `result` with `other`, stores the result inside `result`
+     ** Performs the multiplication of the magnitudes of `result` and `other`, stores the result inside `result`
+     ** The sign of `result` is left to the caller
      */
-    void			multiplication(mabit_t& result, const mabit_t&& other) const
+    void			multiplication(mabit_t& result, const mabit_t& other) const
     {
       const msize_t		r_bits = result.used_bits();
       const msize_t		o_bits = other.used_bits();
@@ -919,105 +1761,213 @@ namespace Mabit
 	  return ;
 	}
 
+      const msize_t		r_words = word_ceil(r_bits);
       const msize_t		o_words = word_ceil(o_bits);
-      mabit_t			tmp_result(result);
+      set_t			product;
 
-      result.clear();
-      result.resize(words_needed);
-      tmp_result.resize(words_needed);
+      product.resize(r_words + o_words);
 
-      for (msize_t i = 0; i < o_words; ++i)
-	{
-	  if (i)
-	    tmp_result <<= _set.BITS_IN_WORD;
+      // The kernel picks schoolbook, Karatsuba or Toom-3 according to the operand sizes
+      if (r_words >= o_words)
+	kernel_t::mul(product.data(), result._set.data(), r_words, other._set.data(), o_words);
+      else
+	kernel_t::mul(product.data(), other._set.data(), o_words, result._set.data(), r_words);
 
-	  for (msize_t j = 0; j < words_needed; ++j)
-	    result.add(j, static_cast<unsigned long long>(other[i]) * tmp_result[j]);
-	}
+      result._set = std::move(product);
+      result.normalize(result._set.size());
+      result.resize(words_needed);
     }
 
     /**
      **	\brief
-     ** Performs the division or modulo of `dividend` with `divisor`, stores the result inside `dividend`
+     ** Squares `result` and stores the result inside `result`
      */
-    void			division(mabit_t& dividend, const mabit_t&& divisor, const bool div_or_mod) const
+    void			squaring(mabit_t& result) const
     {
-      // If dividend == 0, then return
-      if (!dividend.any())
-	return ;
+      const msize_t		bits = result.used_bits();
 
-      // If divisor == 0, then throw an exception
-      if (!divisor.any())
-	return ;
-	//throw std::exception("Mabit: Division by zero");
+      result._sign = true;
+
+      if (!bits)
+	{
+	  result.clear();
+	  return ;
+	}
+
+      const msize_t		words_needed = word_ceil(2 * bits);
 
       // For optimization purpose only
-      if (div_or_mod && divisor.is_power_of_2())
+      if (result.is_power_of_2())
 	{
-	  dividend >>= (divisor.used_bits() - 1);
+	  result.resize(words_needed);
+	  result <<= (bits - 1);
 	  return ;
 	}
 
-      mabit_t			remainder(dividend);
-      mabit_t			tmpdivisor;
-      msize_t			quotient_shift;
+      const msize_t		words = word_ceil(bits);
+      set_t			product;
 
-      // Calculates the secure size for tmpdivisor
-      // so that left shifting its bits will always return the expected value
-      const msize_t		secure_size = word_ceil(remainder.used_bits() + 1);
+      product.resize(2 * words);
 
-      tmpdivisor.resize(secure_size);
+      // Cross products are computed once, see mabit_kernel::sqr()
+      kernel_t::sqr(product.data(), result._set.data(), words);
 
-      // Clears dividends content, will contain either the result of the division or the modulo
-      dividend.clear();
+      result._set = std::move(product);
+      result.normalize(result._set.size());
+      result.resize(words_needed);
+    }
 
-      while (true)
+    /**
+     **	\brief
+     ** Stores *this ^ exp mod m inside `result`, m being the modulus of `ctx` (mabit_montgomery or mabit_barrett)
+     ** Left to right sliding window: every run of up to k bits starting and ending with a 1 costs one product by an odd power
+     */
+    template<typename ctx_t>
+    void			exponentiation(mabit_t& result, const ctx_t& ctx, const mabit_t& exp) const
+    {
+      const msize_t		n = ctx.size();
+      const msize_t		bits = exp.used_bits();
+      const msize_t		k = bits > 2048 ? 6 : bits > 512 ? 5 : bits > 128 ? 4 : bits > 32 ? 3 : bits > 8 ? 2 : 1;
+      word_t* const		r = result._set.data();
+      typename kernel_t::scratch_t	scratch(ctx.itch());
+      word_t* const		tp = scratch.data();
+
+      if (!bits)
+	ctx.one(r, tp);
+      else
 	{
-	  // Division without rest
-	  if (remainder == divisor)
+	  // powers holds g, g^3, g^5 ... g^(2^k - 1), g being the base in residue form
+	  set_t			powers;
+
+	  powers.resize(n << (k - 1));
+
+	  word_t* const		g = powers.data();
+	  bool			started = false;
+
+	  ctx.to_residue(g, _set.data(), used_words(), tp);
+	  if (!_sign && kernel_t::normalize(g, n))
+	    kernel_t::sub_n(g, ctx.modulus(), g, n);
+
+	  if (k > 1)
 	    {
-	      // Sets the result to 0 if the operation is modulo, or adds 1 to the final result of division
-	      div_or_mod ? dividend.add(0, 1) : dividend.clear();
-	      return ;
+	      ctx.sqr(r, g, tp);
+	      for (msize_t i = n; i < powers.size(); i += n)
+		ctx.mul(g + i, g + i - n, r, tp);
 	    }
 
-	  // Remainder is smaller than divisor, cannot divide anymore
-	  if (remainder < divisor)
+	  for (msize_t i = bits; i > 0;)
 	    {
-	      // Stores either the result of modulo or division
-	      dividend = div_or_mod ? dividend : remainder;
-	      return ;
+	      if (!exp.get_bit(i - 1))
+		{
+		  ctx.sqr(r, r, tp);
+		  --i;
+		  continue;
+		}
+
+	      msize_t		low = i > k ? i - k : 0;
+	      msize_t		window = 0;
+
+	      while (!exp.get_bit(low))
+		++low;
+	      for (msize_t j = i; j > low; --j)
+		window = (window << 1) | exp.get_bit(j - 1);
+
+	      if (started)
+		{
+		  for (msize_t j = low; j < i; ++j)
+		    ctx.sqr(r, r, tp);
+		  ctx.mul(r, r, g + (window >> 1) * n, tp);
+		}
+	      else
+		std::copy(g + (window >> 1) * n, g + (window >> 1) * n + n, r);
+	      started = true;
+	      i = low;
 	    }
+	}
+
+      ctx.from_residue(r, r, tp);
+      result.normalize(n);
+    }
+
+    /**
+     **	\brief
+     ** Divides the magnitude of `quotient` by the one of `divisor` in a single pass
+     ** The quotient is left inside `quotient` and the remainder stored inside `remainder`, both keep the dividend size
+     */
+    void			division(mabit_t& quotient, mabit_t& remainder, const mabit_t& divisor) const
+    {
+      // Works on the magnitudes, the signs are left to the caller
+      quotient._sign = true;
 
-	  const msize_t		tmpdividend_bits = remainder.used_bits();
+      // If dividend == 0, then return
+      if (!quotient.any())
+	{
+	  remainder = quotient;
+	  return ;
+	}
 
-	  // Sets tmpdivisor to real divisor
-	  tmpdivisor = divisor;
+      // If divisor == 0, then throw an exception
+      if (!divisor.any())
+	{
+	  remainder = quotient;
+	  return ;
+	  //throw std::exception("Mabit: Division by zero");
+	}
 
-	  tmpdivisor.resize(word_ceil(tmpdividend_bits + 1));
+      // For optimization purpose only
+      if (divisor.is_power_of_2())
+	{
+	  remainder = quotient;
 
-	  // Calculates quotient_shift
-	  quotient_shift = tmpdividend_bits - divisor.used_bits();
+	  const msize_t		shift = divisor.used_bits() - 1;
 
-	  if (quotient_shift > 0)
-	    --quotient_shift;
+	  const msize_t		word = shift / _set.BITS_IN_WORD;
 
-	  // Makes tmpdivisor the highest divisor possible for remainder
-	  tmpdivisor <<= quotient_shift;
+	  quotient >>= shift;
 
-	  if (tmpdivisor > remainder)
-	    tmpdivisor >>= 1;
+	  // The remainder is made of the bits below the divisor's one
+	  if (word < remainder._set.size())
+	    {
+	      std::fill(remainder._set.begin() + word + 1, remainder._set.end(), 0);
+	      remainder._set[word] &= static_cast<word_t>((static_cast<word_t>(1) << (shift % _set.BITS_IN_WORD)) - 1);
+	      remainder.normalize(word + 1);
+	    }
+	  return ;
+	}
 
-	  // Adds quotient to final result (quotient is a multiple of 2, so a simple addition into the right sector is enough)
-	  dividend.add(quotient_shift / _set.BITS_IN_WORD, 1ULL << (quotient_shift % _set.BITS_IN_WORD));
+      const msize_t		n_words = quotient.used_words();
+      const msize_t		d_words = divisor.used_words();
 
-	  // Subtracts the highest divisor found to the remainder
-	  remainder -= tmpdivisor;
+      // Dividend is smaller than divisor, cannot divide
+      if (n_words < d_words)
+	{
+	  remainder = quotient;
+	  quotient.clear();
+	  return ;
 	}
+
+      const msize_t		size = quotient._set.size();
+      set_t			q;
+      set_t			r;
+
+      q.resize(n_words - d_words + 1);
+      r.resize(d_words);
+
+      // Long division (Knuth's algorithm D, or Burnikel-Ziegler for big divisors)
+      kernel_t::divrem(q.data(), r.data(), quotient._set.data(), n_words, divisor._set.data(), d_words);
+
+      quotient._set = std::move(q);
+      quotient.normalize(quotient._set.size());
+      quotient.resize(size);
+      remainder._set = std::move(r);
+      remainder.normalize(remainder._set.size());
+      remainder.resize(size);
     }
   };
 }
 
 #include "mabit_stream.hpp"
+#include "mabit_gcd.hpp"
+#include "mabit_root.hpp"
 
 #endif // !MABIT_HPP
@@ -0,0 +1,169 @@
+#ifndef MABIT_BARRETT_HPP
+#define MABIT_BARRETT_HPP
+
+#include <algorithm>					// std::copy, std::fill
+#include <memory>					// std::allocator
+#include <vector>
+#include "mabit_traits.hpp"
+#include "mabit_kernel.hpp"
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Arithmetic modulo any number m of n words, reduced by Barrett's method with mu = floor((B^2n - 1) / m), B being 2^BITS_IN_WORD
+   ** Residues are the plain values, arrays of n words below m, results may be written over the operands
+   ** The context is never written once set up, the scratch space of itch() words being given by the caller as `tp`
+   */
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_barrett
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef typename kernel_t::scratch_t		scratch_t;
+
+    /**
+     ** \brief
+     ** `m` must verify m[n - 1] != 0
+     */
+    mabit_barrett(word_cp m, const msize_t n)
+      : _m(m, m + n), _mu(n + 1)
+    {
+      // Unlike B^2n / m, mu fits n + 1 words for m = B^(n - 1) too
+      const scratch_t	power(2 * n, static_cast<word_t>(~static_cast<word_t>(0)));
+      scratch_t		r(n);
+
+      kernel_t::divrem(_mu.data(), r.data(), power.data(), 2 * n, m, n);
+    }
+
+    msize_t		size() const
+    {
+      return _m.size();
+    }
+
+    word_cp		modulus() const
+    {
+      return _m.data();
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of words of scratch space the operations below need
+     */
+    msize_t		itch() const
+    {
+      // t, q and q * m take 6n + 3 words, followed by the scratch space of the kernel multiplications
+      return 6 * size() + 3 + kernel_t::mul_itch(size() + 1);
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, an) mod m, without any division
+     ** `r` must not overlap `a`
+     */
+    void		to_residue(word_p r, word_cp a, const msize_t an, word_p tp) const
+    {
+      const msize_t	n = size();
+      msize_t		low = an > 2 * n ? an - 2 * n : 0;
+
+      if (an < n || (an == n && kernel_t::cmp(a, _m.data(), n) < 0))
+	{
+	  std::copy(a, a + an, r);
+	  std::fill(r + an, r + n, 0);
+	  return ;
+	}
+
+      std::copy(a + low, a + an, tp);
+      std::fill(tp + (an - low), tp + 2 * n, 0);
+      reduce(r, tp);
+
+      // Longer values are folded from the top, n words at a time: r * B^step + a[low, low + step) < m * B^n
+      while (low)
+	{
+	  const msize_t	step = low < n ? low : n;
+
+	  low -= step;
+	  std::copy(a + low, a + low + step, tp);
+	  std::copy(r, r + n, tp + step);
+	  std::fill(tp + step + n, tp + 2 * n, 0);
+	  reduce(r, tp);
+	}
+    }
+
+    void		from_residue(word_p r, word_cp a, word_p) const
+    {
+      std::copy(a, a + size(), r);
+    }
+
+    void		one(word_p r, word_p tp) const
+    {
+      const word_t	w = 1;
+
+      to_residue(r, &w, 1, tp);
+    }
+
+    void		mul(word_p r, word_cp a, word_cp b, word_p tp) const
+    {
+      const msize_t	n = size();
+
+      if (a == b)
+	{
+	  sqr(r, a, tp);
+	  return ;
+	}
+
+      kernel_t::mul_n(tp, a, b, n, tp + 6 * n + 3);
+      reduce(r, tp);
+    }
+
+    void		sqr(word_p r, word_cp a, word_p tp) const
+    {
+      kernel_t::sqr_n(tp, a, size(), tp + 6 * size() + 3);
+      reduce(r, tp);
+    }
+
+  private:
+    /**
+     ** \brief
+     ** r[0, n) = t[0, 2n) mod m, t being the start of the scratch space
+     */
+    void		reduce(word_p r, word_p t) const
+    {
+      const msize_t	n = size();
+
+      word_p		q = t + 2 * n;
+      word_p		p = q + 2 * n + 2;
+      const word_p	tp = p + 2 * n + 1;
+
+      // q = floor(floor(t / B^(n - 1)) * mu / B^(n + 1)) falls short of t / m by 3 at most
+      kernel_t::mul_n(q, t + n - 1, _mu.data(), n + 1, tp);
+      q += n + 1;
+
+      // Only the low n + 1 words of q * m are needed, half a schoolbook product
+      if (n < kernel_t::KARATSUBA_THRESHOLD)
+	{
+	  p[n] = kernel_t::mul_1(p, _m.data(), n, q[0]);
+	  for (msize_t i = 1; i <= n; ++i)
+	    kernel_t::addmul_1(p + i, _m.data(), n + 1 - i, q[i]);
+	}
+      else
+	kernel_t::mul(p, q, n + 1, _m.data(), n, tp);
+
+      // t - q * m < 4m fits n + 1 words, the borrow out of them is dropped
+      kernel_t::sub_n(t, t, p, n + 1);
+      while (t[n] || kernel_t::cmp(t, _m.data(), n) >= 0)
+	t[n] = static_cast<word_t>(t[n] - kernel_t::sub_n(t, t, _m.data(), n));
+
+      std::copy(t, t + n, r);
+    }
+
+    scratch_t		_m;
+    scratch_t		_mu;
+  };
+}
+
+#endif // !MABIT_BARRETT_HPP
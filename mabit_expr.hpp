@@ -0,0 +1,954 @@
+#ifndef MABIT_EXPR_HPP
+#define MABIT_EXPR_HPP
+
+#include <type_traits>
+#include <utility>					// std::move
+#include "mabit_traits.hpp"
+
+namespace Mabit
+{
+  template<typename word_t, typename alloc_t>
+  class mabit;
+
+  /**
+   ** \brief
+   ** Base of every expression node
+   ** Binary, shift and unary operators on mabit build nodes, evaluated only once assigned to a mabit
+   ** Nodes keep references to their mabit operands, they must not outlive the full expression (no `auto`)
+   */
+  struct mabit_expr_base
+  {
+  };
+
+  template<typename T>
+  struct is_mabit_expr : std::is_base_of<mabit_expr_base, T>
+  {
+  };
+
+  template<typename T>
+  struct is_mabit : std::false_type
+  {
+  };
+
+  template<typename word_t, typename alloc_t>
+  struct is_mabit<mabit<word_t, alloc_t> > : std::true_type
+  {
+  };
+
+  /************************************************************************/
+  /* OPERATIONS                                                           */
+  /************************************************************************/
+  struct mabit_add_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst += src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst += src; }
+  };
+
+  struct mabit_sub_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst -= src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst -= src; dst.negate(); }
+  };
+
+  struct mabit_mul_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst *= src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst *= src; }
+  };
+
+  struct mabit_div_op
+  {
+    typedef std::false_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst /= src; }
+  };
+
+  struct mabit_mod_op
+  {
+    typedef std::false_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst %= src; }
+  };
+
+  struct mabit_and_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst &= src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst &= src; }
+  };
+
+  struct mabit_or_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst |= src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst |= src; }
+  };
+
+  struct mabit_xor_op
+  {
+    typedef std::true_type	reversible;
+
+    template<typename mabit_t, typename T>
+    static void		apply(mabit_t& dst, const T& src)	{ dst ^= src; }
+
+    // dst = src op dst
+    template<typename mabit_t>
+    static void		apply_reversed(mabit_t& dst, const mabit_t& src)	{ dst ^= src; }
+  };
+
+  struct mabit_lshift_op
+  {
+    template<typename mabit_t>
+    static void		apply(mabit_t& dst, const size_t shift)	{ dst <<= shift; }
+  };
+
+  struct mabit_rshift_op
+  {
+    template<typename mabit_t>
+    static void		apply(mabit_t& dst, const size_t shift)	{ dst >>= shift; }
+  };
+
+  struct mabit_neg_op
+  {
+    template<typename mabit_t>
+    static void		apply(mabit_t& dst)			{ dst.negate(); }
+  };
+
+  struct mabit_not_op
+  {
+    // ~x == -x - 1
+    template<typename mabit_t>
+    static void		apply(mabit_t& dst)			{ dst.negate(); dst -= 1; }
+  };
+
+  struct mabit_abs_op
+  {
+    template<typename mabit_t>
+    static void		apply(mabit_t& dst)			{ if (dst < mabit_t(0)) dst.negate(); }
+  };
+
+  /************************************************************************/
+  /* NODES                                                                */
+  /************************************************************************/
+  /**
+   ** \brief
+   ** Leaf of an expression, refers to a mabit operand
+   */
+  template<typename mabit_type>
+  class mabit_ref
+  {
+  public:
+    typedef mabit_type		mabit_t;
+
+    explicit mabit_ref(const mabit_t& m) : _m(m)
+    {
+    }
+
+    void		eval(mabit_t& dst) const
+    {
+      if (&dst != &_m)
+	dst = _m;
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return &m == &_m;
+    }
+
+    template<typename E>
+    void		share_with(const E&)
+    {
+    }
+
+    const mabit_t&	get() const
+    {
+      return _m;
+    }
+
+  private:
+    const mabit_t&	_m;
+  };
+
+  /**
+   ** \brief
+   ** Leaf of an expression, refers to an expiring mabit operand
+   ** Its words are taken over by the destination instead of being copied, unless the expression reads it elsewhere
+   */
+  template<typename mabit_type>
+  class mabit_temp
+  {
+  public:
+    typedef mabit_type		mabit_t;
+
+    explicit mabit_temp(mabit_t& m) : _m(m), _shared(false)
+    {
+    }
+
+    void		eval(mabit_t& dst) const
+    {
+      if (&dst == &_m)
+	return ;
+      if (_shared)
+	dst = _m;
+      else
+	dst = std::move(_m);
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return &m == &_m;
+    }
+
+    /**
+     ** \brief
+     ** Keeps the words of the operand if `other`, another part of the expression, reads it too
+     */
+    template<typename E>
+    void		share_with(const E& other)
+    {
+      _shared = _shared || other.refers_to(_m);
+    }
+
+    const mabit_t&	get() const
+    {
+      return _m;
+    }
+
+  private:
+    mabit_t&		_m;
+    bool		_shared;
+  };
+
+  template<typename T>
+  struct is_mabit_ref : std::false_type
+  {
+  };
+
+  template<typename mabit_t>
+  struct is_mabit_ref<mabit_ref<mabit_t> > : std::true_type
+  {
+  };
+
+  template<typename T>
+  struct is_mabit_temp : std::false_type
+  {
+  };
+
+  template<typename mabit_t>
+  struct is_mabit_temp<mabit_temp<mabit_t> > : std::true_type
+  {
+  };
+
+  /**
+   ** \brief
+   ** Returns whether `l` and `r` are the very same mabit operand
+   */
+  template<typename L, typename R>
+  bool			mabit_same(const L&, const R&)
+  {
+    return false;
+  }
+
+  template<typename mabit_t>
+  bool			mabit_same(const mabit_ref<mabit_t>& l, const mabit_ref<mabit_t>& r)
+  {
+    return &l.get() == &r.get();
+  }
+
+  template<typename mabit_t>
+  bool			mabit_same(const mabit_ref<mabit_t>& l, const mabit_temp<mabit_t>& r)
+  {
+    return &l.get() == &r.get();
+  }
+
+  template<typename mabit_t>
+  bool			mabit_same(const mabit_temp<mabit_t>& l, const mabit_ref<mabit_t>& r)
+  {
+    return &l.get() == &r.get();
+  }
+
+  template<typename mabit_t>
+  bool			mabit_same(const mabit_temp<mabit_t>& l, const mabit_temp<mabit_t>& r)
+  {
+    return &l.get() == &r.get();
+  }
+
+  template<typename op_t, typename L, typename R>
+  class mabit_binary_expr;
+
+  /**
+   ** \brief
+   ** Applies `op_t` to `dst` and the value of the node `src`, which is evaluated aside first
+   ** Overloads below fuse some operations instead
+   */
+  template<typename op_t, typename mabit_t, typename expr_t>
+  typename std::enable_if<is_mabit_expr<expr_t>::value>::type
+			mabit_apply(const op_t, mabit_t& dst, const expr_t& src);
+
+  template<typename op_t, typename mabit_t>
+  void			mabit_apply(const op_t, mabit_t& dst, const mabit_ref<mabit_t>& src)
+  {
+    op_t::apply(dst, src.get());
+  }
+
+  template<typename op_t, typename mabit_t>
+  void			mabit_apply(const op_t, mabit_t& dst, const mabit_temp<mabit_t>& src)
+  {
+    op_t::apply(dst, src.get());
+  }
+
+  template<typename op_t, typename L, typename R>
+  class mabit_binary_expr : public mabit_expr_base
+  {
+  public:
+    typedef typename L::mabit_t	mabit_t;
+
+    // An operand appearing on both sides cannot lend its words to the result
+    mabit_binary_expr(const L& l, const R& r) : _l(l), _r(r)
+    {
+      _l.share_with(_r);
+      _r.share_with(_l);
+    }
+
+    /**
+     ** \brief
+     ** Evaluates the left operand inside `dst`, then applies the right one to it
+     */
+    void		eval(mabit_t& dst) const
+    {
+      // The right operand is read once `dst` got overwritten, so it must not be `dst`
+      if (_r.refers_to(dst))
+	{
+	  mabit_t		tmp;
+
+	  eval(tmp);
+	  dst = std::move(tmp);
+	  return ;
+	}
+
+      if (reverse(dst, reverse_t()))
+	return ;
+
+      _l.eval(dst);
+
+      // x op x works in place (x * x squares)
+      if (mabit_same(_l, _r))
+	op_t::apply(dst, dst);
+      else
+	mabit_apply(op_t(), dst, _r);
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return _l.refers_to(m) || _r.refers_to(m);
+    }
+
+    template<typename E>
+    void		share_with(const E& other)
+    {
+      _l.share_with(other);
+      _r.share_with(other);
+    }
+
+    const L&		left() const
+    {
+      return _l;
+    }
+
+    const R&		right() const
+    {
+      return _r;
+    }
+
+  private:
+    L			_l;
+    R			_r;
+
+    // a op b(expiring) is evaluated as b op a, inside the words of b, when `op_t` allows it
+    typedef std::integral_constant<bool, op_t::reversible::value
+				   && is_mabit_ref<L>::value
+				   && is_mabit_temp<R>::value>	reverse_t;
+
+    bool		reverse(mabit_t&, std::false_type) const
+    {
+      return false;
+    }
+
+    bool		reverse(mabit_t& dst, std::true_type) const
+    {
+      if (_l.refers_to(dst))
+	return false;
+      _r.eval(dst);
+      op_t::apply_reversed(dst, _l.get());
+      return true;
+    }
+  };
+
+  template<typename op_t, typename E>
+  class mabit_shift_expr : public mabit_expr_base
+  {
+  public:
+    typedef typename E::mabit_t	mabit_t;
+
+    mabit_shift_expr(const E& e, const size_t shift) : _e(e), _shift(shift)
+    {
+    }
+
+    void		eval(mabit_t& dst) const
+    {
+      _e.eval(dst);
+      op_t::apply(dst, _shift);
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return _e.refers_to(m);
+    }
+
+    template<typename E2>
+    void		share_with(const E2& other)
+    {
+      _e.share_with(other);
+    }
+
+  private:
+    E			_e;
+    const size_t	_shift;
+  };
+
+  /**
+   ** \brief
+   ** Applies `op_t` with a native integer to a node or an expiring mabit, which may only lend its words once the whole expression is known
+   */
+  template<typename op_t, typename E, typename int_type>
+  class mabit_native_expr : public mabit_expr_base
+  {
+  public:
+    typedef typename E::mabit_t	mabit_t;
+
+    mabit_native_expr(const E& e, const int_type val) : _e(e), _val(val)
+    {
+    }
+
+    void		eval(mabit_t& dst) const
+    {
+      _e.eval(dst);
+      op_t::apply(dst, _val);
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return _e.refers_to(m);
+    }
+
+    template<typename E2>
+    void		share_with(const E2& other)
+    {
+      _e.share_with(other);
+    }
+
+  private:
+    E			_e;
+    const int_type	_val;
+  };
+
+  template<typename op_t, typename E>
+  class mabit_unary_expr : public mabit_expr_base
+  {
+  public:
+    typedef typename E::mabit_t	mabit_t;
+
+    explicit mabit_unary_expr(const E& e) : _e(e)
+    {
+    }
+
+    void		eval(mabit_t& dst) const
+    {
+      _e.eval(dst);
+      op_t::apply(dst);
+    }
+
+    bool		refers_to(const mabit_t& m) const
+    {
+      return _e.refers_to(m);
+    }
+
+    template<typename E2>
+    void		share_with(const E2& other)
+    {
+      _e.share_with(other);
+    }
+
+    const E&		operand() const
+    {
+      return _e;
+    }
+
+  private:
+    E			_e;
+  };
+
+  /**
+   ** \brief
+   ** Value of an operand: a reference for a mabit, the evaluated mabit for a node
+   */
+  template<typename T>
+  class mabit_value
+  {
+  public:
+    typedef typename T::mabit_t	mabit_t;
+
+    explicit mabit_value(const T& e) : _v(e)
+    {
+    }
+
+    const mabit_t&	get() const
+    {
+      return _v;
+    }
+
+  private:
+    const mabit_t	_v;
+  };
+
+  template<typename mabit_type>
+  class mabit_value<mabit_ref<mabit_type> >
+  {
+  public:
+    typedef mabit_type		mabit_t;
+
+    explicit mabit_value(const mabit_ref<mabit_t>& r) : _v(r.get())
+    {
+    }
+
+    const mabit_t&	get() const
+    {
+      return _v;
+    }
+
+  private:
+    const mabit_t&	_v;
+  };
+
+  template<typename mabit_type>
+  class mabit_value<mabit_temp<mabit_type> >
+  {
+  public:
+    typedef mabit_type		mabit_t;
+
+    explicit mabit_value(const mabit_temp<mabit_t>& t) : _v(t.get())
+    {
+    }
+
+    const mabit_t&	get() const
+    {
+      return _v;
+    }
+
+  private:
+    const mabit_t&	_v;
+  };
+
+  /**
+   ** \brief
+   ** Copy of the node `src` in which an expiring operand keeps its words if it is `dst` too
+   */
+  template<typename mabit_t, typename expr_t>
+  expr_t		mabit_keeping(const expr_t& src, const mabit_t& dst)
+  {
+    expr_t		ret(src);
+
+    ret.share_with(mabit_ref<mabit_t>(dst));
+    return ret;
+  }
+
+  template<typename op_t, typename mabit_t, typename expr_t>
+  typename std::enable_if<is_mabit_expr<expr_t>::value>::type
+			mabit_apply(const op_t, mabit_t& dst, const expr_t& src)
+  {
+    const mabit_value<expr_t>	v(mabit_keeping(src, dst));
+
+    op_t::apply(dst, v.get());
+  }
+
+  // dst += a * b
+  template<typename mabit_t, typename L, typename R>
+  void			mabit_apply(const mabit_add_op, mabit_t& dst, const mabit_binary_expr<mabit_mul_op, L, R>& src)
+  {
+    const mabit_binary_expr<mabit_mul_op, L, R>	e = mabit_keeping(src, dst);
+    const mabit_value<L>	a(e.left());
+    const mabit_value<R>	b(e.right());
+
+    dst.addmul(a.get(), b.get());
+  }
+
+  // dst -= a * b
+  template<typename mabit_t, typename L, typename R>
+  void			mabit_apply(const mabit_sub_op, mabit_t& dst, const mabit_binary_expr<mabit_mul_op, L, R>& src)
+  {
+    const mabit_binary_expr<mabit_mul_op, L, R>	e = mabit_keeping(src, dst);
+    const mabit_value<L>	a(e.left());
+    const mabit_value<R>	b(e.right());
+
+    dst.submul(a.get(), b.get());
+  }
+
+  // dst &= ~b
+  template<typename mabit_t, typename E>
+  void			mabit_apply(const mabit_and_op, mabit_t& dst, const mabit_unary_expr<mabit_not_op, E>& src)
+  {
+    const mabit_unary_expr<mabit_not_op, E>	e = mabit_keeping(src, dst);
+    const mabit_value<E>	b(e.operand());
+
+    dst.andnot(b.get());
+  }
+
+  /************************************************************************/
+  /* OPERAND TRAITS                                                       */
+  /************************************************************************/
+  /**
+   ** \brief
+   ** Turns a mabit or a node into an operand of a node, undefined for anything else
+   ** `T` is the type deduced for a forwarding reference, so that rvalues are told apart
+   */
+  template<typename T, typename = void>
+  struct mabit_operand
+  {
+  };
+
+  template<typename T>
+  struct mabit_operand<T, typename std::enable_if<is_mabit<typename std::decay<T>::type>::value
+						  && (std::is_lvalue_reference<T>::value
+						      || std::is_const<typename std::remove_reference<T>::type>::value)>::type>
+  {
+    typedef typename std::decay<T>::type	mabit_t;
+    typedef mabit_ref<mabit_t>			type;
+
+    static type		wrap(const mabit_t& m)
+    {
+      return type(m);
+    }
+  };
+
+  // Rvalues lend their words to the result
+  template<typename T>
+  struct mabit_operand<T, typename std::enable_if<is_mabit<typename std::decay<T>::type>::value
+						  && !std::is_lvalue_reference<T>::value
+						  && !std::is_const<typename std::remove_reference<T>::type>::value>::type>
+  {
+    typedef typename std::decay<T>::type	mabit_t;
+    typedef mabit_temp<mabit_t>			type;
+
+    static type		wrap(mabit_t& m)
+    {
+      return type(m);
+    }
+  };
+
+  template<typename T>
+  struct mabit_operand<T, typename std::enable_if<is_mabit_expr<typename std::decay<T>::type>::value>::type>
+  {
+    typedef typename std::decay<T>::type::mabit_t	mabit_t;
+    typedef typename std::decay<T>::type		type;
+
+    static const type&	wrap(const type& e)
+    {
+      return e;
+    }
+  };
+
+  template<typename op_t, typename L, typename R, typename = void>
+  struct mabit_binary_type
+  {
+  };
+
+  template<typename op_t, typename L, typename R>
+  struct mabit_binary_type<op_t, L, R, typename std::enable_if<std::is_same<typename mabit_operand<L>::mabit_t,
+									    typename mabit_operand<R>::mabit_t>::value>::type>
+  {
+    typedef mabit_binary_expr<op_t, typename mabit_operand<L>::type, typename mabit_operand<R>::type>	type;
+
+    static type		make(L&& l, R&& r)
+    {
+      return type(mabit_operand<L>::wrap(l), mabit_operand<R>::wrap(r));
+    }
+  };
+
+  /**
+   ** \brief
+   ** Result of an operator between a native integer and a node or a mabit, `T` being deduced like in mabit_operand
+   ** Arithmetic operators on a mabit are its members, bitwise ones are all here
+   */
+  template<typename op_t, typename T, typename int_type, bool bitwise, typename = void>
+  struct mabit_native_type
+  {
+  };
+
+  // Nodes and expiring mabit build a node, as an expiring operand read elsewhere must keep its words
+  template<typename op_t, typename T, typename int_type, bool bitwise>
+  struct mabit_native_type<op_t, T, int_type, bitwise, typename std::enable_if<std::is_integral<int_type>::value
+									       && (is_mabit_expr<typename std::decay<T>::type>::value
+										   || (bitwise && is_mabit_temp<typename mabit_operand<T>::type>::value))>::type>
+  {
+    typedef mabit_native_expr<op_t, typename mabit_operand<T>::type, int_type>	type;
+
+    static type		make(T&& e, const int_type val)
+    {
+      return type(mabit_operand<T>::wrap(e), val);
+    }
+  };
+
+  // Other mabit are evaluated at once
+  template<typename op_t, typename T, typename int_type>
+  struct mabit_native_type<op_t, T, int_type, true, typename std::enable_if<std::is_integral<int_type>::value
+									    && is_mabit_ref<typename mabit_operand<T>::type>::value>::type>
+  {
+    typedef typename mabit_operand<T>::mabit_t	type;
+
+    static type		make(T&& e, const int_type val)
+    {
+      type		ret(e);
+
+      op_t::apply(ret, val);
+      return ret;
+    }
+  };
+
+  /**
+   ** \brief
+   ** Comparisons involving a node, the other side being a mabit, a node or a native integer
+   */
+  template<typename L, typename R, typename = void>
+  struct mabit_compare_type
+  {
+  };
+
+  template<typename L, typename R>
+  struct mabit_compare_type<L, R, typename std::enable_if<(is_mabit_expr<L>::value
+							   && (is_mabit_expr<R>::value || is_mabit<R>::value || std::is_integral<R>::value))
+							  || (is_mabit<L>::value && is_mabit_expr<R>::value)
+							  || (std::is_integral<L>::value && is_mabit_expr<R>::value)>::type>
+  {
+    typedef typename std::conditional<is_mabit_expr<L>::value, L, R>::type::mabit_t	mabit_t;
+    typedef bool									type;
+  };
+
+  /************************************************************************/
+  /* BINARY OPERATORS  +  -  *  /  %  &  |  ^                             */
+  /************************************************************************/
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_add_op, L, R>::type	operator + (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_add_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_sub_op, L, R>::type	operator - (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_sub_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_mul_op, L, R>::type	operator * (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_mul_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_div_op, L, R>::type	operator / (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_div_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_mod_op, L, R>::type	operator % (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_mod_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_and_op, L, R>::type	operator & (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_and_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_or_op, L, R>::type	operator | (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_or_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  template<typename L, typename R>
+  typename mabit_binary_type<mabit_xor_op, L, R>::type	operator ^ (L&& l, R&& r)
+  {
+    return mabit_binary_type<mabit_xor_op, L, R>::make(std::forward<L>(l), std::forward<R>(r));
+  }
+
+  /************************************************************************/
+  /* SHIFT AND UNARY OPERATORS  <<  >>  -  ~                              */
+  /************************************************************************/
+  template<typename E>
+  mabit_shift_expr<mabit_lshift_op, typename mabit_operand<E>::type>	operator << (E&& e, const size_t shift)
+  {
+    return mabit_shift_expr<mabit_lshift_op, typename mabit_operand<E>::type>(mabit_operand<E>::wrap(e), shift);
+  }
+
+  template<typename E>
+  mabit_shift_expr<mabit_rshift_op, typename mabit_operand<E>::type>	operator >> (E&& e, const size_t shift)
+  {
+    return mabit_shift_expr<mabit_rshift_op, typename mabit_operand<E>::type>(mabit_operand<E>::wrap(e), shift);
+  }
+
+  template<typename E>
+  mabit_unary_expr<mabit_neg_op, typename mabit_operand<E>::type>	operator - (E&& e)
+  {
+    return mabit_unary_expr<mabit_neg_op, typename mabit_operand<E>::type>(mabit_operand<E>::wrap(e));
+  }
+
+  template<typename E>
+  mabit_unary_expr<mabit_not_op, typename mabit_operand<E>::type>	operator ~ (E&& e)
+  {
+    return mabit_unary_expr<mabit_not_op, typename mabit_operand<E>::type>(mabit_operand<E>::wrap(e));
+  }
+
+  /************************************************************************/
+  /* NATIVE INTEGER OPERANDS  +  -  *  /  %  &  |  ^                      */
+  /************************************************************************/
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_add_op, E, int_type, false>::type	operator + (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_add_op, E, int_type, false>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_sub_op, E, int_type, false>::type	operator - (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_sub_op, E, int_type, false>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_mul_op, E, int_type, false>::type	operator * (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_mul_op, E, int_type, false>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_div_op, E, int_type, false>::type	operator / (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_div_op, E, int_type, false>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_mod_op, E, int_type, false>::type	operator % (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_mod_op, E, int_type, false>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_and_op, E, int_type, true>::type	operator & (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_and_op, E, int_type, true>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_or_op, E, int_type, true>::type	operator | (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_or_op, E, int_type, true>::make(std::forward<E>(e), val);
+  }
+
+  template<typename E, typename int_type>
+  typename mabit_native_type<mabit_xor_op, E, int_type, true>::type	operator ^ (E&& e, const int_type val)
+  {
+    return mabit_native_type<mabit_xor_op, E, int_type, true>::make(std::forward<E>(e), val);
+  }
+
+  /************************************************************************/
+  /* COMPARISON OPERATORS  ==  !=  <  <=  >  >=                           */
+  /************************************************************************/
+  // Nodes get evaluated, mabit operands are compared in place
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator == (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv == rv;
+  }
+
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator != (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv != rv;
+  }
+
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator < (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv < rv;
+  }
+
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator <= (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv <= rv;
+  }
+
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator > (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv > rv;
+  }
+
+  template<typename L, typename R>
+  typename mabit_compare_type<L, R>::type	operator >= (const L& l, const R& r)
+  {
+    const typename mabit_compare_type<L, R>::mabit_t&	lv = l;
+    const typename mabit_compare_type<L, R>::mabit_t&	rv = r;
+
+    return lv >= rv;
+  }
+}
+
+#endif // !MABIT_EXPR_HPP
@@ -0,0 +1,533 @@
+#ifndef MABIT_GCD_HPP
+#define MABIT_GCD_HPP
+
+#include <algorithm>					// std::copy
+#include <utility>					// std::move, std::swap
+#include <vector>
+#include "mabit_traits.hpp"
+#include "mabit.hpp"
+#include "mabit_kernel.hpp"
+
+// Sizes (in words) from which the half gcd takes over Lehmer's algorithm, inside a half gcd and for a whole gcd
+#ifndef MABIT_HGCD_THRESHOLD
+# define MABIT_HGCD_THRESHOLD		100
+#endif
+
+#ifndef MABIT_GCD_DC_THRESHOLD
+# define MABIT_GCD_DC_THRESHOLD		600
+#endif
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Greatest common divisors of magnitudes, with or without cofactors
+   ** Two words go through binary gcd, bigger operands through Lehmer's algorithm on their two leading words,
+   ** and from MABIT_GCD_DC_THRESHOLD words through a half gcd (Moller) riding on the multiplication
+   */
+  template<typename word_t, typename alloc_t>
+  class mabit_gcd
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+    typedef mabit<word_t, alloc_t>			mabit_t;
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef std::vector<word_t, alloc_t>		words_t;
+
+    static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
+    static const msize_t				HGCD_THRESHOLD = MABIT_HGCD_THRESHOLD;
+    static const msize_t				GCD_DC_THRESHOLD = MABIT_GCD_DC_THRESHOLD;
+
+    static_assert(HGCD_THRESHOLD >= 4, "Mabit: half gcd threshold should be >= 4");
+    static_assert(GCD_DC_THRESHOLD >= HGCD_THRESHOLD, "Mabit: gcd threshold should be >= half gcd threshold");
+
+    /**
+     ** \brief
+     ** Matrix [[m00, m01], [m10, m11]] of non negative entries and determinant 1 or -1, `det` being true for 1
+     ** A reduction of (a, b) to (alpha, beta) keeps (a, b) = M (alpha, beta)
+     */
+    struct matrix
+    {
+      matrix() : m00(1), m01(0), m10(0), m11(1), det(true)
+      {
+      }
+
+      mabit_t		m00;
+      mabit_t		m01;
+      mabit_t		m10;
+      mabit_t		m11;
+      bool		det;
+    };
+
+    /**
+     ** \brief
+     ** Returns the greatest common divisor of |a| and |b|
+     */
+    static mabit_t	gcd(const mabit_t& a, const mabit_t& b)
+    {
+      mabit_t		u = a.abs();
+      mabit_t		v = b.abs();
+
+      if (!v.any())
+	return u;
+      if (!u.any())
+	return v;
+
+      // Common factors of 2 are put back at the end, the others do not matter
+      const msize_t	uz = u.count_trailing_zeros();
+      const msize_t	vz = v.count_trailing_zeros();
+      const msize_t	shift = uz < vz ? uz : vz;
+
+      u >>= uz;
+      v >>= vz;
+      if (u.cmp_abs(v) < 0)
+	std::swap(u, v);
+
+      reduction(u, v, nullptr);
+
+      const msize_t	words = u.word_ceil(u.used_bits() + shift);
+
+      if (u.size() < words)
+	u.resize(words);
+      u <<= shift;
+      return u;
+    }
+
+    /**
+     ** \brief
+     ** Returns g = gcd(|a|, |b|) and stores inside `s` and `t` cofactors such that g = s * a + t * b
+     ** |s| <= |b| / g and |t| <= |a| / g, (1, 0) and (0, 1) standing for a null b and a null a
+     */
+    static mabit_t	gcdext(const mabit_t& a, const mabit_t& b, mabit_t& s, mabit_t& t)
+    {
+      const bool	swapped = a.cmp_abs(b) < 0;
+      mabit_t		u = swapped ? b.abs() : a.abs();
+      mabit_t		v = swapped ? a.abs() : b.abs();
+      matrix		m;
+      mabit_t		x;
+      mabit_t		y;
+
+      if (v.any())
+	{
+	  reduction(u, v, &m);
+
+	  // (u0, v0) = M (g, 0) gives g = det(M) (m11 u0 - m01 v0)
+	  x = std::move(m.m11);
+	  y = std::move(m.m01);
+	  if (m.det)
+	    y.negate();
+	  else
+	    x.negate();
+	}
+      else
+	x = mabit_t(1);
+
+      if (swapped)
+	std::swap(x, y);
+      if (!a._sign)
+	x.negate();
+      if (!b._sign)
+	y.negate();
+
+      s = std::move(x);
+      t = std::move(y);
+      return u;
+    }
+
+  private:
+    /**
+     ** \brief
+     ** Reduces (u, v), u >= v, down to (gcd, 0), composing the reductions into `m` when given
+     */
+    static void		reduction(mabit_t& u, mabit_t& v, matrix* const m)
+    {
+      while (v.any())
+	{
+	  const msize_t	n = u.used_words();
+
+	  // Without cofactors, small operands are left to binary gcd
+	  if (!m && n <= 2)
+	    {
+	      u = from_dword(binary_gcd(to_dword(u), to_dword(v)));
+	      v.clear();
+	      return ;
+	    }
+	  if (!m && v.used_words() == 1)
+	    {
+	      const word_t	r = u.divmod(v._set[0], u);
+
+	      u = from_dword(binary_gcd(v._set[0], r));
+	      v.clear();
+	      return ;
+	    }
+
+	  if (n >= GCD_DC_THRESHOLD && half_step(u, v, m))
+	    continue;
+	  if (!lehmer_step(u, v, m, 0))
+	    division_step(u, v, m, 0);
+	}
+    }
+
+    /**
+     ** \brief
+     ** Reduces (u, v) by the half gcd of their leading half, returns false when it does not apply
+     */
+    static bool		half_step(mabit_t& u, mabit_t& v, matrix* const m)
+    {
+      const msize_t	p = u.used_words() / 2;
+      mabit_t		a = high(u, p);
+      mabit_t		b = high(v, p);
+      matrix		h;
+
+      if (!hgcd(a, b, h) || !apply(h, u, v))
+	return false;
+
+      if (m)
+	multiply(*m, h);
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** Half gcd: reduces (a, b), a >= b, as long as both stay above s = n / 2 + 1 words, n being the size of a
+     ** The reduction is stored inside `m`, returns whether there was one
+     ** Stopping there, the reduction of the leading words of two numbers holds for the whole numbers (Moller)
+     */
+    static bool		hgcd(mabit_t& a, mabit_t& b, matrix& m)
+    {
+      const msize_t	n = a.used_words();
+      const msize_t	s = n / 2 + 1;
+      bool		reduced = false;
+
+      if (b.used_words() <= s)
+	return false;
+
+      if (n >= HGCD_THRESHOLD)
+	{
+	  // The leading half brings (a, b) down to about 3n / 4 words
+	  const msize_t	p = n / 2;
+	  mabit_t	a1 = high(a, p);
+	  mabit_t	b1 = high(b, p);
+
+	  if (hgcd(a1, b1, m))
+	    reduced = apply(m, a, b);
+	  if (!reduced)
+	    m = matrix();
+
+	  // Without a step left, (a, b) is as reduced as it gets
+	  while (a.used_words() > (3 * n) / 4 + 1)
+	    {
+	      if (b.used_words() <= s || !step(a, b, m, s))
+		return reduced;
+	      reduced = true;
+	    }
+
+	  // The leading 2(l - s) words bring them down to s + 1 words
+	  const msize_t	l = a.used_words();
+
+	  if (l > s + 2 && b.used_words() > s)
+	    {
+	      const msize_t	p2 = 2 * s - l + 1;
+	      mabit_t		a2 = high(a, p2);
+	      mabit_t		b2 = high(b, p2);
+	      matrix		m2;
+
+	      if (hgcd(a2, b2, m2) && apply(m2, a, b))
+		{
+		  multiply(m, m2);
+		  reduced = true;
+		}
+	    }
+	}
+
+      while (b.used_words() > s && step(a, b, m, s))
+	reduced = true;
+      return reduced;
+    }
+
+    /**
+     ** \brief
+     ** One step of the reduction of (a, b) keeping b above s words, returns false when there is none
+     */
+    static bool		step(mabit_t& a, mabit_t& b, matrix& m, const msize_t s)
+    {
+      return lehmer_step(a, b, &m, s) || division_step(a, b, &m, s);
+    }
+
+    /**
+     ** \brief
+     ** (u, v) = (v, u mod v), returns false instead if u mod v does not stay above s words
+     */
+    static bool		division_step(mabit_t& u, mabit_t& v, matrix* const m, const msize_t s)
+    {
+      mabit_t		q;
+      mabit_t		r;
+
+      u.divmod(v, q, r);
+      if (s && r.used_words() <= s)
+	return false;
+
+      u = std::move(v);
+      v = std::move(r);
+
+      // M [[q, 1], [1, 0]]
+      if (m)
+	{
+	  mabit_t	t = m->m00 * q + m->m01;
+
+	  m->m01 = std::move(m->m00);
+	  m->m00 = std::move(t);
+	  t = m->m10 * q + m->m11;
+	  m->m11 = std::move(m->m10);
+	  m->m10 = std::move(t);
+	  m->det = !m->det;
+	}
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** Runs Euclid's algorithm on the 2 * BITS_IN_WORD - 1 leading bits of u and v (Knuth's algorithm L)
+     ** then applies the cofactors it gathered to (u, v), whose remainder has to stay above s words
+     ** Returns false if no quotient could be told from the leading bits
+     */
+    static bool		lehmer_step(mabit_t& u, mabit_t& v, matrix* const m, const msize_t s)
+    {
+      static const msize_t	LEADING = 2 * BITS_IN_WORD - 1;
+
+      const msize_t	bits = u.used_bits();
+      const msize_t	h = bits > LEADING ? bits - LEADING : 0;
+      dword_t		x = leading(u, h);
+      dword_t		y = leading(v, h);
+      dword_t		limit = 0;
+
+      // The remainders approximated by y are at most 2^(BITS_IN_WORD + 1) away from y 2^h
+      if (s)
+	{
+	  if (s * BITS_IN_WORD >= h + LEADING)
+	    return false;
+	  limit = (s * BITS_IN_WORD > h ? static_cast<dword_t>(1) << (s * BITS_IN_WORD - h) : 0)
+	    + (static_cast<dword_t>(1) << (BITS_IN_WORD + 1));
+	}
+
+      // Magnitudes of the cofactors A, B, C, D, A and D being positive after an even number of steps, B and C after an odd one
+      const dword_t	word_max = static_cast<word_t>(~static_cast<word_t>(0));
+      dword_t		a = 1;
+      dword_t		b = 0;
+      dword_t		c = 0;
+      dword_t		d = 1;
+      bool		even = true;
+
+      for (;;)
+	{
+	  // The quotient is known if it is the same for the bounds (x + A) / (y + C) and (x + B) / (y + D)
+	  if (even ? y <= c || x < b : y <= d || x < a)
+	    break;
+
+	  const dword_t	q = even ? (x + a) / (y - c) : (x - a) / (y + c);
+
+	  if (q != (even ? (x - b) / (y + d) : (x + b) / (y - d)) || q > word_max)
+	    break;
+
+	  const dword_t	next_c = a + q * c;
+	  const dword_t	next_d = b + q * d;
+	  const dword_t	next_y = x - q * y;
+
+	  if (next_c > word_max || next_d > word_max || next_y < limit)
+	    break;
+
+	  a = c;
+	  c = next_c;
+	  b = d;
+	  d = next_d;
+	  x = y;
+	  y = next_y;
+	  even = !even;
+	}
+
+      if (!b)
+	return false;
+
+      const msize_t	n = u.used_words();
+      words_t		nu(n);
+      words_t		nv(n);
+
+      if (v._set.size() < n)
+	v._set.resize(n, 0);
+
+      // (u, v) = (A u + B v, C u + D v)
+      word_cp		pu = u._set.data();
+      word_cp		pv = v._set.data();
+
+      if (even)
+	{
+	  combine(nu.data(), pu, static_cast<word_t>(a), pv, static_cast<word_t>(b), n);
+	  combine(nv.data(), pv, static_cast<word_t>(d), pu, static_cast<word_t>(c), n);
+	}
+      else
+	{
+	  combine(nu.data(), pv, static_cast<word_t>(b), pu, static_cast<word_t>(a), n);
+	  combine(nv.data(), pu, static_cast<word_t>(c), pv, static_cast<word_t>(d), n);
+	}
+
+      if (s && kernel_t::normalize(nv.data(), n) <= s)
+	return false;
+
+      std::copy(nu.begin(), nu.end(), u._set.begin());
+      std::copy(nv.begin(), nv.end(), v._set.begin());
+      u.normalize(n);
+      v.normalize(n);
+
+      // The inverse of [[A, B], [C, D]] is [[|D|, |B|], [|C|, |A|]]
+      if (m)
+	{
+	  mabit_t	t = m->m00 * static_cast<word_t>(b) + m->m01 * static_cast<word_t>(a);
+
+	  m->m00 = m->m00 * static_cast<word_t>(d) + m->m01 * static_cast<word_t>(c);
+	  m->m01 = std::move(t);
+	  t = m->m10 * static_cast<word_t>(b) + m->m11 * static_cast<word_t>(a);
+	  m->m10 = m->m10 * static_cast<word_t>(d) + m->m11 * static_cast<word_t>(c);
+	  m->m11 = std::move(t);
+
+	  // Every step of Euclid's algorithm changes the sign of the determinant
+	  m->det = m->det == even;
+	}
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = x[0, n) * p - y[0, n) * q, known to be a non negative number of n words
+     */
+    static void		combine(word_p r, word_cp x, const word_t p, word_cp y, const word_t q, const msize_t n)
+    {
+      kernel_t::mul_1(r, x, n, p);
+      kernel_t::submul_1(r, y, n, q);
+    }
+
+    /**
+     ** \brief
+     ** (a, b) = M^-1 (a, b), returns false and leaves them untouched if the result is not a reduction
+     */
+    static bool		apply(const matrix& m, mabit_t& a, mabit_t& b)
+    {
+      // The inverse of M is +-[[m11, -m01], [-m10, m00]]
+      mabit_t		x = m.m11 * a - m.m01 * b;
+      mabit_t		y = m.m00 * b - m.m10 * a;
+
+      if ((x.any() && y.any() && x._sign != y._sign) || x.cmp_abs(y) < 0)
+	return false;
+
+      a = std::move(x).abs();
+      b = std::move(y).abs();
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** m = m n
+     */
+    static void		multiply(matrix& m, const matrix& n)
+    {
+      mabit_t		t = m.m00 * n.m01 + m.m01 * n.m11;
+
+      m.m00 = m.m00 * n.m00 + m.m01 * n.m10;
+      m.m01 = std::move(t);
+      t = m.m10 * n.m01 + m.m11 * n.m11;
+      m.m10 = m.m10 * n.m00 + m.m11 * n.m10;
+      m.m11 = std::move(t);
+      m.det = m.det == n.det;
+    }
+
+    /**
+     ** \brief
+     ** Returns x / 2^(p * BITS_IN_WORD)
+     */
+    static mabit_t	high(const mabit_t& x, const msize_t p)
+    {
+      const msize_t	n = x.used_words();
+      mabit_t		ret;
+
+      if (n > p)
+	{
+	  ret.resize(n - p);
+	  std::copy(x._set.begin() + p, x._set.begin() + n, ret._set.begin());
+	  ret.normalize(n - p);
+	}
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns the bits [h, h + 2 * BITS_IN_WORD - 1) of x
+     */
+    static dword_t	leading(const mabit_t& x, const msize_t h)
+    {
+      const msize_t	n = x._set.size();
+      const msize_t	w = h / BITS_IN_WORD;
+      const unsigned	shift = h % BITS_IN_WORD;
+      dword_t		ret = 0;
+
+      if (w < n)
+	ret = x._set[w] >> shift;
+      if (w + 1 < n)
+	ret |= static_cast<dword_t>(x._set[w + 1]) << (BITS_IN_WORD - shift);
+      if (shift && w + 2 < n)
+	ret |= static_cast<dword_t>(x._set[w + 2]) << (2 * BITS_IN_WORD - shift);
+      return ret & (~static_cast<dword_t>(0) >> (sizeof(dword_t) * 8 - (2 * BITS_IN_WORD - 1)));
+    }
+
+    static dword_t	to_dword(const mabit_t& x)
+    {
+      const msize_t	n = x.used_words();
+      dword_t		ret = n > 1 ? static_cast<dword_t>(x._set[1]) << BITS_IN_WORD : 0;
+
+      return n ? ret | x._set[0] : ret;
+    }
+
+    static mabit_t	from_dword(const dword_t x)
+    {
+      mabit_t		ret;
+
+      ret.resize(2 < mabit_t::MIN_SIZE ? mabit_t::MIN_SIZE : 2);
+      ret._set[0] = static_cast<word_t>(x);
+      ret._set[1] = static_cast<word_t>(x >> BITS_IN_WORD);
+      ret.normalize(2);
+      return ret;
+    }
+
+    static unsigned	ctz(const dword_t x)
+    {
+      const word_t	low = static_cast<word_t>(x);
+
+      return low ? kernel_t::ctz(low) : BITS_IN_WORD + kernel_t::ctz(static_cast<word_t>(x >> BITS_IN_WORD));
+    }
+
+    /**
+     ** \brief
+     ** Stein's binary gcd of two numbers of two words at most
+     */
+    static dword_t	binary_gcd(dword_t x, dword_t y)
+    {
+      if (!x || !y)
+	return x | y;
+
+      const unsigned	shift = ctz(x | y);
+
+      x >>= ctz(x);
+      while (y)
+	{
+	  y >>= ctz(y);
+	  if (x > y)
+	    std::swap(x, y);
+	  y -= x;
+	}
+      return x << shift;
+    }
+  };
+}
+
+#endif // !MABIT_GCD_HPP
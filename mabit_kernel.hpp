@@ -0,0 +1,1207 @@
+#ifndef MABIT_KERNEL_HPP
+#define MABIT_KERNEL_HPP
+
+#include <algorithm>					// std::copy, std::fill, std::min
+#include <memory>					// std::allocator
+#include <vector>
+#include "mabit_traits.hpp"
+#include "mabit_ntt.hpp"
+
+// Carries of 32 and 64 bits words go through the ADC and SBB intrinsics on x86-64
+#if defined(__x86_64__) && defined(__GNUC__)
+# define MABIT_KERNEL_X86_CARRY
+# include <x86intrin.h>
+#endif
+
+// Operand sizes (in words) from which each multiplication algorithm takes over
+#ifndef MABIT_KARATSUBA_THRESHOLD
+# define MABIT_KARATSUBA_THRESHOLD	28
+#endif
+
+#ifndef MABIT_SQR_KARATSUBA_THRESHOLD
+# define MABIT_SQR_KARATSUBA_THRESHOLD	40
+#endif
+
+#ifndef MABIT_TOOM3_THRESHOLD
+# define MABIT_TOOM3_THRESHOLD		200
+#endif
+
+#ifndef MABIT_NTT_THRESHOLD
+# define MABIT_NTT_THRESHOLD		2000
+#endif
+
+// Divisor size (in words) from which division goes divide and conquer
+#ifndef MABIT_DC_DIV_THRESHOLD
+# define MABIT_DC_DIV_THRESHOLD		60
+#endif
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Arithmetic on raw arrays of words, least significant word first
+   ** Every operand is an unsigned number, every size is counted in words
+   ** Scratch space comes from `alloc_t`
+   */
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_kernel
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+
+    typedef mabit_ntt<word_t>				ntt_t;
+    typedef std::vector<word_t, alloc_t>		scratch_t;
+
+    static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
+    static const word_t					WORD_MAX = ~static_cast<word_t>(0);
+
+    static const msize_t				KARATSUBA_THRESHOLD = MABIT_KARATSUBA_THRESHOLD;
+    static const msize_t				SQR_KARATSUBA_THRESHOLD = MABIT_SQR_KARATSUBA_THRESHOLD;
+    static const msize_t				TOOM3_THRESHOLD = MABIT_TOOM3_THRESHOLD;
+    static const msize_t				NTT_THRESHOLD = MABIT_NTT_THRESHOLD;
+    static const msize_t				DC_DIV_THRESHOLD = MABIT_DC_DIV_THRESHOLD;
+
+    static_assert(KARATSUBA_THRESHOLD >= 4, "Mabit: karatsuba threshold should be >= 4");
+    static_assert(SQR_KARATSUBA_THRESHOLD >= 4, "Mabit: karatsuba squaring threshold should be >= 4");
+    static_assert(TOOM3_THRESHOLD >= 8, "Mabit: toom3 threshold should be >= 8");
+    static_assert(DC_DIV_THRESHOLD >= 4, "Mabit: divide and conquer division threshold should be >= 4");
+
+    /**
+     ** \brief
+     ** Returns the number of words of `a` once its leading zero words are removed
+     */
+    static msize_t	normalize(word_cp a, msize_t n)
+    {
+      while (n > 0 && !a[n - 1])
+	--n;
+      return n;
+    }
+
+    /**
+     ** \brief
+     ** Compares a[0, n) with b[0, n), returns -1, 0 or 1
+     */
+    static int		cmp(word_cp a, word_cp b, msize_t n)
+    {
+      while (n-- > 0)
+	if (a[n] != b[n])
+	  return a[n] < b[n] ? -1 : 1;
+      return 0;
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of leading zero bits of `w`, which must not be 0
+     */
+    static unsigned	clz(const word_t w)
+    {
+      return __builtin_clzll(w) - (sizeof(unsigned long long) * 8 - BITS_IN_WORD);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of trailing zero bits of `w`, which must not be 0
+     */
+    static unsigned	ctz(const word_t w)
+    {
+      return __builtin_ctzll(w);
+    }
+
+    static unsigned	popcount(const word_t w)
+    {
+      return __builtin_popcountll(w);
+    }
+
+    /**
+     ** \brief
+     ** Returns a + b + carry, `carry` (0 or 1) being replaced by the carry out
+     */
+    static word_t	addc(const word_t a, const word_t b, unsigned char& carry)
+    {
+#ifdef MABIT_KERNEL_X86_CARRY
+      if (sizeof(word_t) == sizeof(unsigned long long))
+	{
+	  unsigned long long	r;
+
+	  carry = _addcarry_u64(carry, a, b, &r);
+	  return static_cast<word_t>(r);
+	}
+      if (sizeof(word_t) == sizeof(unsigned int))
+	{
+	  unsigned int		r;
+
+	  carry = _addcarry_u32(carry, static_cast<unsigned int>(a), static_cast<unsigned int>(b), &r);
+	  return static_cast<word_t>(r);
+	}
+#endif
+      const dword_t	s = static_cast<dword_t>(a) + b + carry;
+
+      carry = static_cast<unsigned char>(s >> BITS_IN_WORD);
+      return static_cast<word_t>(s);
+    }
+
+    /**
+     ** \brief
+     ** Returns a - b - borrow, `borrow` (0 or 1) being replaced by the borrow out
+     */
+    static word_t	subb(const word_t a, const word_t b, unsigned char& borrow)
+    {
+#ifdef MABIT_KERNEL_X86_CARRY
+      if (sizeof(word_t) == sizeof(unsigned long long))
+	{
+	  unsigned long long	r;
+
+	  borrow = _subborrow_u64(borrow, a, b, &r);
+	  return static_cast<word_t>(r);
+	}
+      if (sizeof(word_t) == sizeof(unsigned int))
+	{
+	  unsigned int		r;
+
+	  borrow = _subborrow_u32(borrow, static_cast<unsigned int>(a), static_cast<unsigned int>(b), &r);
+	  return static_cast<word_t>(r);
+	}
+#endif
+      const dword_t	d = static_cast<dword_t>(a) - b - borrow;
+
+      borrow = static_cast<unsigned char>((d >> BITS_IN_WORD) & 1);
+      return static_cast<word_t>(d);
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) + b[0, n), returns the carry
+     ** The loop is unrolled by 4 so that the carry stays in the flags from one word to the next
+     */
+    static word_t	add_n(word_p r, word_cp a, word_cp b, const msize_t n)
+    {
+      unsigned char	carry = 0;
+      msize_t		i = 0;
+
+      for (; i + 4 <= n; i += 4)
+	{
+	  r[i] = addc(a[i], b[i], carry);
+	  r[i + 1] = addc(a[i + 1], b[i + 1], carry);
+	  r[i + 2] = addc(a[i + 2], b[i + 2], carry);
+	  r[i + 3] = addc(a[i + 3], b[i + 3], carry);
+	}
+      for (; i < n; ++i)
+	r[i] = addc(a[i], b[i], carry);
+      return carry;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) - b[0, n), returns the borrow
+     */
+    static word_t	sub_n(word_p r, word_cp a, word_cp b, const msize_t n)
+    {
+      unsigned char	borrow = 0;
+      msize_t		i = 0;
+
+      for (; i + 4 <= n; i += 4)
+	{
+	  r[i] = subb(a[i], b[i], borrow);
+	  r[i + 1] = subb(a[i + 1], b[i + 1], borrow);
+	  r[i + 2] = subb(a[i + 2], b[i + 2], borrow);
+	  r[i + 3] = subb(a[i + 3], b[i + 3], borrow);
+	}
+      for (; i < n; ++i)
+	r[i] = subb(a[i], b[i], borrow);
+      return borrow;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) + w, returns the carry
+     */
+    static word_t	add_1(word_p r, word_cp a, const msize_t n, word_t w)
+    {
+      msize_t		i = 0;
+
+      for (; i < n && w; ++i)
+	{
+	  const word_t	x = a[i];
+
+	  r[i] = static_cast<word_t>(x + w);
+	  w = r[i] < x;
+	}
+      if (r != a)
+	std::copy(a + i, a + n, r + i);
+      return w;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) - w, returns the borrow
+     */
+    static word_t	sub_1(word_p r, word_cp a, const msize_t n, word_t w)
+    {
+      msize_t		i = 0;
+
+      for (; i < n && w; ++i)
+	{
+	  const word_t	x = a[i];
+
+	  r[i] = static_cast<word_t>(x - w);
+	  w = x < w;
+	}
+      if (r != a)
+	std::copy(a + i, a + n, r + i);
+      return w;
+    }
+
+    /**
+     ** \brief
+     ** r[0, an) = a[0, an) + b[0, bn), with an >= bn, returns the carry
+     */
+    static word_t	add(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn)
+    {
+      return add_1(r + bn, a + bn, an - bn, add_n(r, a, b, bn));
+    }
+
+    /**
+     ** \brief
+     ** r[0, an) = a[0, an) - b[0, bn), with an >= bn, returns the borrow
+     */
+    static word_t	sub(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn)
+    {
+      return sub_1(r + bn, a + bn, an - bn, sub_n(r, a, b, bn));
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) << cnt, with 0 < cnt < BITS_IN_WORD, returns the bits shifted out
+     ** `r` may be `a`, or start above it
+     */
+    static word_t	lshift(word_p r, word_cp a, const msize_t n, const unsigned cnt)
+    {
+      const unsigned	sub_cnt = BITS_IN_WORD - cnt;
+      const word_t	out = a[n - 1] >> sub_cnt;
+
+      for (msize_t i = n - 1; i > 0; --i)
+	r[i] = static_cast<word_t>(a[i] << cnt) | (a[i - 1] >> sub_cnt);
+      r[0] = static_cast<word_t>(a[0] << cnt);
+      return out;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) >> cnt, with 0 < cnt < BITS_IN_WORD, returns the bits shifted out
+     ** (in the most significant bits of the returned word)
+     ** `r` may be `a`, or start below it
+     */
+    static word_t	rshift(word_p r, word_cp a, const msize_t n, const unsigned cnt)
+    {
+      const unsigned	sub_cnt = BITS_IN_WORD - cnt;
+      const word_t	out = static_cast<word_t>(a[0] << sub_cnt);
+
+      for (msize_t i = 0; i < n - 1; ++i)
+	r[i] = (a[i] >> cnt) | static_cast<word_t>(a[i + 1] << sub_cnt);
+      r[n - 1] = a[n - 1] >> cnt;
+      return out;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) * w, returns the carry word
+     */
+    static word_t	mul_1(word_p r, word_cp a, const msize_t n, const word_t w)
+    {
+      word_t		carry = 0;
+
+      for (msize_t i = 0; i < n; ++i)
+	{
+	  const dword_t	p = static_cast<dword_t>(a[i]) * w + carry;
+
+	  r[i] = static_cast<word_t>(p);
+	  carry = static_cast<word_t>(p >> BITS_IN_WORD);
+	}
+      return carry;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) += a[0, n) * w, returns the carry word
+     */
+    static word_t	addmul_1(word_p r, word_cp a, const msize_t n, const word_t w)
+    {
+      word_t		carry = 0;
+
+      for (msize_t i = 0; i < n; ++i)
+	{
+	  const dword_t	p = static_cast<dword_t>(a[i]) * w + r[i] + carry;
+
+	  r[i] = static_cast<word_t>(p);
+	  carry = static_cast<word_t>(p >> BITS_IN_WORD);
+	}
+      return carry;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) -= a[0, n) * w, returns the borrow word
+     */
+    static word_t	submul_1(word_p r, word_cp a, const msize_t n, const word_t w)
+    {
+      word_t		borrow = 0;
+
+      for (msize_t i = 0; i < n; ++i)
+	{
+	  const dword_t	p = static_cast<dword_t>(a[i]) * w + borrow;
+	  const word_t	lo = static_cast<word_t>(p);
+	  const word_t	x = r[i];
+
+	  r[i] = static_cast<word_t>(x - lo);
+	  borrow = static_cast<word_t>(p >> BITS_IN_WORD) + (x < lo);
+	}
+      return borrow;
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, n) / 3, when a is known to be a multiple of 3
+     */
+    static void		divexact_by3(word_p r, word_cp a, const msize_t n)
+    {
+      // Inverse of 3 modulo 2^BITS_IN_WORD
+      static const word_t	inverse = static_cast<word_t>((WORD_MAX / 3) * 2 + 1);
+      word_t			carry = 0;
+
+      for (msize_t i = 0; i < n; ++i)
+	{
+	  const word_t	x = a[i];
+	  const word_t	l = static_cast<word_t>(x - carry);
+	  const word_t	q = static_cast<word_t>(l * inverse);
+
+	  r[i] = q;
+	  carry = static_cast<word_t>((static_cast<dword_t>(q) * 3) >> BITS_IN_WORD) + (x < carry);
+	}
+    }
+
+    /**
+     ** \brief
+     ** r[0, an + bn) = a[0, an) * b[0, bn), with an >= bn > 0
+     ** `r` must not overlap the operands
+     */
+    static void		mul(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn)
+    {
+      if (bn < KARATSUBA_THRESHOLD)
+	{
+	  mul_basecase(r, a, an, b, bn);
+	  return ;
+	}
+
+      if (bn >= NTT_THRESHOLD && ntt_t::fits(an, bn))
+	{
+	  ntt_t::mul(r, a, an, b, bn);
+	  return ;
+	}
+
+      scratch_t		scratch(mul_itch(bn));
+
+      mul(r, a, an, b, bn, scratch.data());
+    }
+
+    /**
+     ** \brief
+     ** r[0, 2n) = a[0, n)^2, with n > 0
+     ** `r` must not overlap the operand
+     */
+    static void		sqr(word_p r, word_cp a, const msize_t n)
+    {
+      if (n < SQR_KARATSUBA_THRESHOLD)
+	{
+	  sqr_basecase(r, a, n);
+	  return ;
+	}
+
+      scratch_t		scratch(mul_n_itch(n));
+
+      sqr_n(r, a, n, scratch.data());
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of scratch words needed by mul() for a `bn` words operand
+     */
+    static msize_t	mul_itch(const msize_t bn)
+    {
+      return 2 * bn + mul_n_itch(bn);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of scratch words needed by mul_n() and sqr_n()
+     */
+    static msize_t	mul_n_itch(msize_t n)
+    {
+      msize_t		itch = 0;
+
+      // Karatsuba takes 6 * ceil(n / 2) + 1 words per level, Toom-3 a bit less
+      // Bounding every level by the same increasing function keeps the estimate monotonic
+      for (; n >= KARATSUBA_THRESHOLD || n >= SQR_KARATSUBA_THRESHOLD; n = n / 2 + 1)
+	itch += 3 * n + 16;
+      return itch;
+    }
+
+    /**
+     ** \brief
+     ** mul() on the scratch space `tp` of mul_itch(bn) words: `a` is processed in slices of `bn` words
+     ** Only a last slice shorter than `bn` words, yet past the Karatsuba threshold, makes its own scratch space
+     */
+    static void		mul(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn, word_p tp)
+    {
+      if (bn < KARATSUBA_THRESHOLD)
+	{
+	  mul_basecase(r, a, an, b, bn);
+	  return ;
+	}
+
+      mul_n(r, a, b, bn, tp);
+
+      word_p		tmp = tp;
+
+      tp += 2 * bn;
+
+      for (msize_t done = bn; done < an; done += bn)
+	{
+	  const msize_t	len = std::min(bn, an - done);
+
+	  if (len == bn)
+	    mul_n(tmp, a + done, b, bn, tp);
+	  else
+	    mul(tmp, b, bn, a + done, len);
+
+	  // The lower `bn` words overlap the previous product, the upper ones are new
+	  std::copy(tmp + bn, tmp + bn + len, r + done + bn);
+	  add_1(r + done + bn, r + done + bn, len, add_n(r + done, r + done, tmp, bn));
+	}
+    }
+
+    /**
+     ** \brief
+     ** r[0, 2n) = a[0, n) * b[0, n) on the scratch space `tp` of mul_n_itch(n) words, picks the algorithm according to `n`
+     ** `r` must not overlap the operands
+     */
+    static void		mul_n(word_p r, word_cp a, word_cp b, const msize_t n, word_p tp)
+    {
+      if (n < KARATSUBA_THRESHOLD)
+	mul_basecase(r, a, n, b, n);
+      else if (n < TOOM3_THRESHOLD)
+	karatsuba(r, a, b, n, tp);
+      else if (n < NTT_THRESHOLD || !ntt_t::fits(n, n))
+	toom3(r, a, b, n, tp);
+      else
+	ntt_t::mul(r, a, n, b, n);
+    }
+
+    /**
+     ** \brief
+     ** r[0, 2n) = a[0, n)^2 on the scratch space `tp` of mul_n_itch(n) words, picks the algorithm according to `n`
+     ** `r` must not overlap the operand
+     */
+    static void		sqr_n(word_p r, word_cp a, const msize_t n, word_p tp)
+    {
+      if (n < SQR_KARATSUBA_THRESHOLD)
+	sqr_basecase(r, a, n);
+      else if (n < TOOM3_THRESHOLD)
+	karatsuba_sqr(r, a, n, tp);
+      else if (n < NTT_THRESHOLD || !ntt_t::fits(n, n))
+	toom3_sqr(r, a, n, tp);
+      else
+	ntt_t::sqr(r, a, n);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of digits of `base` (at least 2) one word can hold
+     */
+    static unsigned	radix_digits(const unsigned base)
+    {
+      unsigned long long	power = base;
+      unsigned		digits = 1;
+
+      for (; power <= static_cast<unsigned long long>(WORD_MAX) / base; power *= base)
+	++digits;
+      return digits;
+    }
+
+    /**
+     ** \brief
+     ** Returns base^radix_digits(base), the biggest power of `base` a word can hold
+     */
+    static word_t	radix_power(const unsigned base)
+    {
+      word_t		power = 1;
+
+      for (unsigned i = radix_digits(base); i > 0; --i)
+	power = static_cast<word_t>(power * base);
+      return power;
+    }
+
+    /**
+     ** \brief
+     ** q[0, n) = a[0, n) / d, returns the remainder, with d > 0
+     ** `q` may be `a`
+     */
+    static word_t	divrem_1(word_p q, word_cp a, const msize_t n, word_t d)
+    {
+      const unsigned	shift = clz(d);
+      word_t		r = 0;
+
+      d = static_cast<word_t>(d << shift);
+
+      const word_t	v = invert(d);
+
+      if (shift)
+	r = a[n - 1] >> (BITS_IN_WORD - shift);
+
+      for (msize_t i = n; i-- > 0;)
+	{
+	  word_t	u0 = static_cast<word_t>(a[i] << shift);
+
+	  if (shift && i > 0)
+	    u0 |= a[i - 1] >> (BITS_IN_WORD - shift);
+	  q[i] = div_2by1(r, r, u0, d, v);
+	}
+      return r >> shift;
+    }
+
+    /**
+     ** \brief
+     ** q[0, an - dn + 1) = a[0, an) / d[0, dn), r[0, dn) = a[0, an) % d[0, dn)
+     ** with an >= dn > 0 and d[dn - 1] != 0, `q` and `r` must not overlap the operands
+     */
+    static void		divrem(word_p q, word_p r, word_cp a, const msize_t an, word_cp d, const msize_t dn)
+    {
+      if (dn == 1)
+	{
+	  r[0] = divrem_1(q, a, an, d[0]);
+	  return ;
+	}
+
+      // Knuth's algorithm D wants the most significant bit of the divisor set
+      // The dividend gets one more word so that the shift never overflows
+      const unsigned	shift = clz(d[dn - 1]);
+      scratch_t		u(a, a + an);
+      scratch_t		v(d, d + dn);
+
+      u.push_back(0);
+      if (shift)
+	{
+	  lshift(v.data(), v.data(), dn, shift);
+	  u[an] = lshift(u.data(), u.data(), an, shift);
+	}
+
+      // The extra word keeps the top quotient word null
+      if (dn < DC_DIV_THRESHOLD || an - dn < DC_DIV_THRESHOLD)
+	sb_divrem(q, u.data(), an + 1, v.data(), dn);
+      else
+	dc_divrem(q, u.data(), an + 1, v.data(), dn);
+
+      if (shift)
+	rshift(r, u.data(), dn, shift);
+      else
+	std::copy(u.begin(), u.begin() + dn, r);
+    }
+
+    /**
+     ** \brief
+     ** Returns the inverse of the odd word `w` modulo 2^BITS_IN_WORD
+     */
+    static word_t	binvert(const word_t w)
+    {
+      // w is its own inverse modulo 8, each Newton step doubles the number of exact low bits
+      word_t		inv = w;
+
+      for (msize_t bits = 3; bits < BITS_IN_WORD; bits *= 2)
+	inv = static_cast<word_t>(inv * static_cast<word_t>(2 - w * inv));
+      return inv;
+    }
+
+    /**
+     ** \brief
+     ** Montgomery reduction: r[0, n) = t[0, 2n) / 2^(n * BITS_IN_WORD) mod m[0, n)
+     ** with m odd, t < m * 2^(n * BITS_IN_WORD) and minv = -1 / m[0] mod 2^BITS_IN_WORD (see binvert())
+     ** `t` is destroyed, `r` may be `t + n`
+     */
+    static void		redc(word_p r, word_p t, word_cp m, const msize_t n, const word_t minv)
+    {
+      // Each row cancels the lowest word, whose room keeps the carry until the final addition
+      for (msize_t i = 0; i < n; ++i)
+	t[i] = addmul_1(t + i, m, n, static_cast<word_t>(t[i] * minv));
+
+      // The sum is below 2m
+      if (add_n(r, t + n, t, n) || cmp(r, m, n) >= 0)
+	sub_n(r, r, m, n);
+    }
+
+  private:
+    /**
+     ** \brief
+     ** Schoolbook multiplication, one row of partial products per word of `b`
+     */
+    static void		mul_basecase(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn)
+    {
+      r[an] = mul_1(r, a, an, b[0]);
+
+      for (msize_t i = 1; i < bn; ++i)
+	r[an + i] = addmul_1(r + i, a, an, b[i]);
+    }
+
+    /**
+     ** \brief
+     ** Schoolbook squaring: every cross product a[i] * a[j] (i < j) is computed once then doubled
+     ** before the squares a[i]^2 are added on the diagonal
+     */
+    static void		sqr_basecase(word_p r, word_cp a, const msize_t n)
+    {
+      if (n > 1)
+	{
+	  r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+
+	  for (msize_t i = 1; i + 1 < n; ++i)
+	    r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+
+	  r[0] = 0;
+	  r[2 * n - 1] = 0;
+	  lshift(r, r, 2 * n, 1);
+	}
+      else
+	r[0] = r[1] = 0;
+
+      word_t		carry = 0;
+
+      for (msize_t i = 0; i < n; ++i)
+	{
+	  const dword_t	p = static_cast<dword_t>(a[i]) * a[i];
+	  const dword_t	lo = static_cast<dword_t>(r[2 * i]) + static_cast<word_t>(p) + carry;
+	  const dword_t	hi = static_cast<dword_t>(r[2 * i + 1]) + static_cast<word_t>(p >> BITS_IN_WORD)
+	    + static_cast<word_t>(lo >> BITS_IN_WORD);
+
+	  r[2 * i] = static_cast<word_t>(lo);
+	  r[2 * i + 1] = static_cast<word_t>(hi);
+	  carry = static_cast<word_t>(hi >> BITS_IN_WORD);
+	}
+    }
+
+    /**
+     ** \brief
+     ** r[0, an) = |a[0, an) - b[0, bn)|, with an >= bn
+     ** Returns true if a < b
+     */
+    static bool		abs_diff(word_p r, word_cp a, msize_t an, word_cp b, const msize_t bn)
+    {
+      for (; an > bn && !a[an - 1]; --an)
+	r[an - 1] = 0;
+
+      if (an > bn)
+	{
+	  sub(r, a, an, b, bn);
+	  return false;
+	}
+
+      if (cmp(a, b, bn) >= 0)
+	{
+	  sub_n(r, a, b, bn);
+	  return false;
+	}
+      sub_n(r, b, a, bn);
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** r[0, rn) += a[0, an), the sum being known to fit in `rn` words
+     */
+    static void		add_into(word_p r, const msize_t rn, word_cp a, msize_t an)
+    {
+      an = normalize(a, an);
+      add(r, r, rn, a, an);
+    }
+
+    /**
+     ** \brief
+     ** Karatsuba multiplication, with a = a0 + a1 * B^h and b = b0 + b1 * B^h :
+     ** a * b = a0b0 + (a0b0 + a1b1 - (a0 - a1)(b0 - b1)) * B^h + a1b1 * B^2h
+     */
+    static void		karatsuba(word_p r, word_cp a, word_cp b, const msize_t n, word_p tp)
+    {
+      const msize_t	h = n - n / 2;
+      const msize_t	l = n - h;
+      word_p		t = tp;
+      word_p		u = t + h;
+      word_p		m = u + h;
+      word_p		z = m + 2 * h;
+
+      tp = z + 2 * h + 1;
+
+      const bool	negative = abs_diff(t, a, h, a + h, l) != abs_diff(u, b, h, b + h, l);
+
+      mul_n(r, a, b, h, tp);
+      mul_n(r + 2 * h, a + h, b + h, l, tp);
+      mul_n(m, t, u, h, tp);
+
+      karatsuba_combine(r, n, m, z, negative);
+    }
+
+    /**
+     ** \brief
+     ** Karatsuba squaring: a^2 = a0^2 + (a0^2 + a1^2 - (a0 - a1)^2) * B^h + a1^2 * B^2h
+     */
+    static void		karatsuba_sqr(word_p r, word_cp a, const msize_t n, word_p tp)
+    {
+      const msize_t	h = n - n / 2;
+      const msize_t	l = n - h;
+      word_p		t = tp;
+      word_p		m = t + h;
+      word_p		z = m + 2 * h;
+
+      tp = z + 2 * h + 1;
+
+      abs_diff(t, a, h, a + h, l);
+
+      sqr_n(r, a, h, tp);
+      sqr_n(r + 2 * h, a + h, l, tp);
+      sqr_n(m, t, h, tp);
+
+      karatsuba_combine(r, n, m, z, false);
+    }
+
+    /**
+     ** \brief
+     ** Adds the middle term of Karatsuba to r[0, 2n), which already holds a0b0 and a1b1
+     ** m[0, 2h) is |(a0 - a1)(b0 - b1)|, `negative` its sign, z[0, 2h] is scratch
+     */
+    static void		karatsuba_combine(word_p r, const msize_t n, word_cp m, word_p z, const bool negative)
+    {
+      const msize_t	h = n - n / 2;
+      const msize_t	l = n - h;
+
+      // z = a0b0 + a1b1 -/+ |(a0 - a1)(b0 - b1)|
+      std::copy(r, r + 2 * h, z);
+      z[2 * h] = add(z, z, 2 * h, r + 2 * h, 2 * l);
+
+      if (negative)
+	add(z, z, 2 * h + 1, m, 2 * h);
+      else
+	sub(z, z, 2 * h + 1, m, 2 * h);
+
+      add_into(r + h, 2 * n - h, z, 2 * h + 1);
+    }
+
+    /**
+     ** \brief
+     ** Toom-3 multiplication, splits the operands in three and evaluates them in 0, 1, -1, 2 and infinity
+     ** Coefficients are rebuilt as:
+     **  c0 = v0, c4 = vinf, d = (v1 - vm1) / 2, c2 = (v1 + vm1) / 2 - c0 - c4
+     **  c3 = ((v2 - c0 - 4c2 - 16c4) / 2 - d) / 3, c1 = d - c3
+     */
+    static void		toom3(word_p r, word_cp a, word_cp b, const msize_t n, word_p tp)
+    {
+      const msize_t	k = (n + 2) / 3;
+      const msize_t	s = n - 2 * k;
+      const msize_t	l = 2 * k + 2;
+      word_p		ea = tp;
+      word_p		eb = ea + k + 1;
+      word_p		v1 = eb + k + 1;
+      word_p		vm1 = v1 + l;
+      word_p		v2 = vm1 + l;
+
+      tp = v2 + l;
+
+      // v0 and vinf go straight to their final place
+      mul_n(r, a, b, k, tp);
+      mul_n(r + 4 * k, a + 2 * k, b + 2 * k, s, tp);
+      std::fill(r + 2 * k, r + 4 * k, 0);
+
+      // v1 = (a0 + a1 + a2)(b0 + b1 + b2)
+      eval_1(ea, a, k, s);
+      eval_1(eb, b, k, s);
+      mul_n(v1, ea, eb, k + 1, tp);
+
+      // vm1 = (a0 - a1 + a2)(b0 - b1 + b2)
+      const bool	negative = eval_m1(ea, a, k, s) != eval_m1(eb, b, k, s);
+
+      mul_n(vm1, ea, eb, k + 1, tp);
+
+      // v2 = (a0 + 2a1 + 4a2)(b0 + 2b1 + 4b2)
+      eval_2(ea, a, k, s);
+      eval_2(eb, b, k, s);
+      mul_n(v2, ea, eb, k + 1, tp);
+
+      toom3_interpolate(r, n, v1, vm1, v2, negative);
+    }
+
+    /**
+     ** \brief
+     ** Toom-3 squaring, every evaluation point is squared (so vm1 is never negative)
+     */
+    static void		toom3_sqr(word_p r, word_cp a, const msize_t n, word_p tp)
+    {
+      const msize_t	k = (n + 2) / 3;
+      const msize_t	s = n - 2 * k;
+      const msize_t	l = 2 * k + 2;
+      word_p		ea = tp;
+      word_p		v1 = ea + 2 * (k + 1);
+      word_p		vm1 = v1 + l;
+      word_p		v2 = vm1 + l;
+
+      tp = v2 + l;
+
+      sqr_n(r, a, k, tp);
+      sqr_n(r + 4 * k, a + 2 * k, s, tp);
+      std::fill(r + 2 * k, r + 4 * k, 0);
+
+      eval_1(ea, a, k, s);
+      sqr_n(v1, ea, k + 1, tp);
+
+      eval_m1(ea, a, k, s);
+      sqr_n(vm1, ea, k + 1, tp);
+
+      eval_2(ea, a, k, s);
+      sqr_n(v2, ea, k + 1, tp);
+
+      toom3_interpolate(r, n, v1, vm1, v2, false);
+    }
+
+    /**
+     ** \brief
+     ** Rebuilds the Toom-3 product in r[0, 2n), which already holds v0 and vinf (and zeros in between)
+     ** v1, |vm1| (of sign `negative`) and v2 have 2k + 2 words each and are destroyed
+     */
+    static void		toom3_interpolate(word_p r, const msize_t n, word_p v1, word_p vm1, word_p v2, const bool negative)
+    {
+      const msize_t	k = (n + 2) / 3;
+      const msize_t	s = n - 2 * k;
+      const msize_t	l = 2 * k + 2;
+
+      // vm1 = d = (v1 - vm1) / 2, v1 = c2 = (2 * v1 - 2 * d) / 2 - c0 - c4
+      if (negative)
+	add_n(vm1, v1, vm1, l);
+      else
+	sub_n(vm1, v1, vm1, l);
+      lshift(v1, v1, l, 1);
+      sub_n(v1, v1, vm1, l);
+      rshift(v1, v1, l, 1);
+      rshift(vm1, vm1, l, 1);
+      sub(v1, v1, l, r, 2 * k);
+      sub(v1, v1, l, r + 4 * k, 2 * s);
+
+      // v2 = c3 = ((v2 - c0 - 4c2 - 16c4) / 2 - d) / 3
+      sub(v2, v2, l, r, 2 * k);
+      submul_1(v2, v1, l, 4);
+      sub_1(v2 + 2 * s, v2 + 2 * s, l - 2 * s, submul_1(v2, r + 4 * k, 2 * s, 16));
+      rshift(v2, v2, l, 1);
+      sub_n(v2, v2, vm1, l);
+      divexact_by3(v2, v2, l);
+
+      // vm1 = c1 = d - c3
+      sub_n(vm1, vm1, v2, l);
+
+      add_into(r + k, 2 * n - k, vm1, l);
+      add_into(r + 2 * k, 2 * n - 2 * k, v1, l);
+      add_into(r + 3 * k, 2 * n - 3 * k, v2, l);
+    }
+
+    /**
+     ** \brief
+     ** e[0, k] = a0 + a1 + a2
+     */
+    static void		eval_1(word_p e, word_cp a, const msize_t k, const msize_t s)
+    {
+      e[k] = add(e, a, k, a + 2 * k, s);
+      e[k] += add_n(e, e, a + k, k);
+    }
+
+    /**
+     ** \brief
+     ** e[0, k] = |a0 - a1 + a2|, returns true if a0 - a1 + a2 < 0
+     */
+    static bool		eval_m1(word_p e, word_cp a, const msize_t k, const msize_t s)
+    {
+      e[k] = add(e, a, k, a + 2 * k, s);
+      return abs_diff(e, e, k + 1, a + k, k);
+    }
+
+    /**
+     ** \brief
+     ** e[0, k] = a0 + 2a1 + 4a2
+     */
+    static void		eval_2(word_p e, word_cp a, const msize_t k, const msize_t s)
+    {
+      std::copy(a, a + k, e);
+      e[k] = addmul_1(e, a + k, k, 2);
+      e[k] += add_1(e + s, e + s, k - s, addmul_1(e, a + 2 * k, s, 4));
+    }
+
+    /**
+     ** \brief
+     ** Returns floor((B^2 - 1) / d) - B, B being 2^BITS_IN_WORD, with a normalized `d`
+     */
+    static word_t	invert(const word_t d)
+    {
+      return static_cast<word_t>(((static_cast<dword_t>(static_cast<word_t>(~d)) << BITS_IN_WORD) | WORD_MAX) / d);
+    }
+
+    /**
+     ** \brief
+     ** Returns the reciprocal of (d1, d0) used by div_3by2(), with a normalized `d1`
+     */
+    static word_t	invert_3by2(const word_t d1, const word_t d0)
+    {
+      word_t		v = invert(d1);
+      word_t		p = static_cast<word_t>(d1 * v + d0);
+
+      if (p < d0)
+	{
+	  --v;
+	  if (p >= d1)
+	    {
+	      --v;
+	      p = static_cast<word_t>(p - d1);
+	    }
+	  p = static_cast<word_t>(p - d1);
+	}
+
+      const dword_t	t = static_cast<dword_t>(d0) * v;
+      const word_t	t1 = static_cast<word_t>(t >> BITS_IN_WORD);
+
+      p = static_cast<word_t>(p + t1);
+      if (p < t1)
+	{
+	  --v;
+	  if (p > d1 || (p == d1 && static_cast<word_t>(t) >= d0))
+	    --v;
+	}
+      return v;
+    }
+
+    /**
+     ** \brief
+     ** Divides (u1, u0) by the normalized `d` with u1 < d, `v` being invert(d)
+     ** Returns the quotient word and stores the remainder in `r` (Moller and Granlund)
+     */
+    static word_t	div_2by1(word_t& r, const word_t u1, const word_t u0, const word_t d, const word_t v)
+    {
+      const dword_t	p = static_cast<dword_t>(v) * u1 + ((static_cast<dword_t>(u1) << BITS_IN_WORD) | u0);
+      const word_t	q0 = static_cast<word_t>(p);
+      word_t		q1 = static_cast<word_t>((p >> BITS_IN_WORD) + 1);
+
+      r = static_cast<word_t>(u0 - q1 * d);
+      if (r > q0)
+	{
+	  --q1;
+	  r = static_cast<word_t>(r + d);
+	}
+      if (r >= d)
+	{
+	  ++q1;
+	  r = static_cast<word_t>(r - d);
+	}
+      return q1;
+    }
+
+    /**
+     ** \brief
+     ** Divides (u2, u1, u0) by the normalized (d1, d0) with (u2, u1) < (d1, d0), `v` being invert_3by2(d1, d0)
+     ** Returns the quotient word and stores the remainder in (r1, r0) (Moller and Granlund)
+     */
+    static word_t	div_3by2(word_t& r1, word_t& r0, const word_t u2, const word_t u1, const word_t u0,
+				 const word_t d1, const word_t d0, const word_t v)
+    {
+      // Double words are computed modulo B^2, whatever the width of dword_t
+      static const dword_t	mask = ~static_cast<dword_t>(0) >> (sizeof(dword_t) * 8 - 2 * BITS_IN_WORD);
+      const dword_t	dd = (static_cast<dword_t>(d1) << BITS_IN_WORD) | d0;
+      const dword_t	p = static_cast<dword_t>(v) * u2 + ((static_cast<dword_t>(u2) << BITS_IN_WORD) | u1);
+      const word_t	q0 = static_cast<word_t>(p);
+      word_t		q1 = static_cast<word_t>(p >> BITS_IN_WORD);
+      dword_t		r;
+
+      r1 = static_cast<word_t>(u1 - q1 * d1);
+      r = (((static_cast<dword_t>(r1) << BITS_IN_WORD) | u0) - dd - static_cast<dword_t>(d0) * q1) & mask;
+      ++q1;
+
+      if (static_cast<word_t>(r >> BITS_IN_WORD) >= q0)
+	{
+	  --q1;
+	  r = (r + dd) & mask;
+	}
+      if (r >= dd)
+	{
+	  ++q1;
+	  r -= dd;
+	}
+      r1 = static_cast<word_t>(r >> BITS_IN_WORD);
+      r0 = static_cast<word_t>(r);
+      return static_cast<word_t>(q1);
+    }
+
+    /**
+     ** \brief
+     ** Schoolbook division of u[0, un) by the normalized d[0, dn), with un > dn >= 2
+     ** q[0, un - dn) receives the low words of the quotient and the returned word its top one (0 or 1)
+     ** The remainder is left in u[0, dn)
+     */
+    static word_t	sb_divrem(word_p q, word_p u, const msize_t un, word_cp d, const msize_t dn)
+    {
+      const word_t	d1 = d[dn - 1];
+      const word_t	d0 = d[dn - 2];
+      const word_t	v = invert_3by2(d1, d0);
+      const bool	qh = cmp(u + un - dn, d, dn) >= 0;
+
+      if (qh)
+	sub_n(u + un - dn, u + un - dn, d, dn);
+
+      word_t		n1 = u[un - 1];
+
+      // Every step divides the dn + 1 words u[j, j + dn] (the top one being kept in n1) by `d`
+      for (msize_t j = un - dn; j-- > 0;)
+	{
+	  word_t	qj;
+
+	  if (n1 == d1 && u[j + dn - 1] == d0)
+	    {
+	      qj = WORD_MAX;
+	      submul_1(u + j, d, dn, qj);
+	      n1 = u[j + dn - 1];
+	    }
+	  else
+	    {
+	      word_t	n0;
+
+	      qj = div_3by2(n1, n0, n1, u[j + dn - 1], u[j + dn - 2], d1, d0, v);
+
+	      // Subtracts qj * d from the low words, the estimate may be one too large
+	      const word_t	cy = submul_1(u + j, d, dn - 2, qj);
+	      const bool	cy0 = n0 < cy;
+
+	      n0 = static_cast<word_t>(n0 - cy);
+	      const bool	cy1 = n1 < static_cast<word_t>(cy0);
+
+	      n1 = static_cast<word_t>(n1 - cy0);
+	      u[j + dn - 2] = n0;
+	      if (cy1)
+		{
+		  n1 = static_cast<word_t>(n1 + d1 + add_n(u + j, u + j, d, dn - 1));
+		  --qj;
+		}
+	    }
+	  q[j] = qj;
+	}
+      u[dn - 1] = n1;
+      return qh;
+    }
+
+    /**
+     ** \brief
+     ** Divides u[0, 2n) by the normalized d[0, n) as two 3n/2 by n divisions (Burnikel and Ziegler)
+     ** The quotient goes to q[0, n) and the returned word, the remainder is left in u[0, n)
+     ** tp[0, n) is scratch
+     */
+    static word_t	dc_divrem_n(word_p q, word_p u, word_cp d, const msize_t n, word_p tp)
+    {
+      const msize_t	lo = n / 2;
+      const msize_t	hi = n - lo;
+      word_t		qh;
+      word_t		ql;
+      word_t		cy;
+
+      // High half of the quotient, from the top 2hi words divided by the top hi words of d
+      if (hi < DC_DIV_THRESHOLD)
+	qh = sb_divrem(q + lo, u + 2 * lo, 2 * hi, d + lo, hi);
+      else
+	qh = dc_divrem_n(q + lo, u + 2 * lo, d + lo, hi, tp);
+
+      mul(tp, q + lo, hi, d, lo);
+      cy = sub_n(u + lo, u + lo, tp, n);
+      if (qh)
+	cy += sub_n(u + n, u + n, d, lo);
+
+      // The estimate is at most two too large
+      while (cy)
+	{
+	  qh -= sub_1(q + lo, q + lo, hi, 1);
+	  cy -= add_n(u + lo, u + lo, d, n);
+	}
+
+      // Low half of the quotient, from what is left
+      if (lo < DC_DIV_THRESHOLD)
+	ql = sb_divrem(q, u + hi, 2 * lo, d + hi, lo);
+      else
+	ql = dc_divrem_n(q, u + hi, d + hi, lo, tp);
+
+      mul(tp, d, hi, q, lo);
+      cy = sub_n(u, u, tp, n);
+      if (ql)
+	cy += sub_n(u + lo, u + lo, d, hi);
+
+      while (cy)
+	{
+	  sub_1(q, q, lo, 1);
+	  cy -= add_n(u, u, d, n);
+	}
+      return qh;
+    }
+
+    /**
+     ** \brief
+     ** Divide and conquer division of u[0, un) by the normalized d[0, dn), with un > dn >= DC_DIV_THRESHOLD
+     ** Same contract as sb_divrem(), the quotient is found dn words at a time
+     */
+    static word_t	dc_divrem(word_p q, word_p u, const msize_t un, word_cp d, const msize_t dn)
+    {
+      msize_t		qn = un - dn;
+      scratch_t		tp(dn);
+      word_t		qh;
+
+      // The top block takes the remainder of qn by dn words, so that every other block is complete
+      while (qn > dn)
+	qn -= dn;
+
+      word_p		ub = u + un - qn - dn;
+      word_p		qb = q + un - dn - qn;
+
+      if (qn < DC_DIV_THRESHOLD)
+	qh = sb_divrem(qb, ub, qn + dn, d, dn);
+      else
+	{
+	  // Divides by the top qn words of d, then takes the low ones into account
+	  qh = dc_divrem_n(qb, ub + dn - qn, d + dn - qn, qn, tp.data());
+	  if (qn != dn)
+	    {
+	      word_t	cy;
+
+	      if (qn > dn - qn)
+		mul(tp.data(), qb, qn, d, dn - qn);
+	      else
+		mul(tp.data(), d, dn - qn, qb, qn);
+	      cy = sub_n(ub, ub, tp.data(), dn);
+	      if (qh)
+		cy += sub_n(ub + qn, ub + qn, d, dn - qn);
+
+	      while (cy)
+		{
+		  qh -= sub_1(qb, qb, qn, 1);
+		  cy -= add_n(ub, ub, d, dn);
+		}
+	    }
+	}
+
+      // The remainder being below d, the following blocks never have a top quotient word
+      while (qb != q)
+	{
+	  qb -= dn;
+	  ub -= dn;
+	  dc_divrem_n(qb, ub, d, dn, tp.data());
+	}
+      return qh;
+    }
+  };
+}
+
+#endif // !MABIT_KERNEL_HPP
@@ -0,0 +1,287 @@
+#ifndef MABIT_MODULUS_HPP
+#define MABIT_MODULUS_HPP
+
+#include <memory>					// std::unique_ptr
+#include <stdexcept>					// std::invalid_argument
+#include "mabit_traits.hpp"
+#include "mabit.hpp"
+#include "mabit_kernel.hpp"
+#include "mabit_montgomery.hpp"
+#include "mabit_barrett.hpp"
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Arithmetic modulo a fixed number m, set up once and then free of any division
+   ** reduce(), addmod(), submod(), mulmod() and powmod() take and give plain values, results being in [0, m)
+   ** to_residue() gives values a form in which mul(), sqr(), add() and sub() chain without leaving it, until from_residue()
+   ** That form is Montgomery's for odd moduli (see mabit_montgomery), the plain value for even ones (see mabit_barrett)
+   ** Every call makes its own scratch space, so that a const object may be shared between threads
+   */
+  template<typename word_t, typename alloc_t>
+  class mabit_modulus
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef mabit<word_t, alloc_t>			mabit_t;
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef mabit_montgomery<word_t, alloc_t>		montgomery_t;
+    typedef mabit_barrett<word_t, alloc_t>		barrett_t;
+    typedef typename kernel_t::scratch_t		scratch_t;
+
+    /**
+     ** \brief
+     ** Throws std::invalid_argument if `m` is null, its sign is ignored
+     */
+    explicit mabit_modulus(const mabit_t& m)
+      : _m(checked(m)), _barrett(_m._set.data(), _m.used_words()),
+	_montgomery(_m._set[0] & 1 ? new montgomery_t(_m._set.data(), _m.used_words()) : nullptr)
+    {
+    }
+
+    mabit_modulus(const mabit_modulus& other)
+      : _m(other._m), _barrett(other._barrett),
+	_montgomery(other._montgomery ? new montgomery_t(*other._montgomery) : nullptr)
+    {
+    }
+
+    const mabit_t&	modulus() const
+    {
+      return _m;
+    }
+
+    /************************************************************************/
+    /* PLAIN VALUES                                                         */
+    /************************************************************************/
+    /**
+     ** \brief
+     ** Returns a mod m, in [0, m) whatever the sign of `a`
+     */
+    mabit_t		reduce(const mabit_t& a) const
+    {
+      scratch_t		tp = scratch();
+
+      return reduce(a, tp.data());
+    }
+
+    mabit_t		addmod(const mabit_t& a, const mabit_t& b) const
+    {
+      scratch_t		tp = scratch();
+
+      return add(reduce(a, tp.data()), reduce(b, tp.data()));
+    }
+
+    mabit_t		submod(const mabit_t& a, const mabit_t& b) const
+    {
+      scratch_t		tp = scratch();
+
+      return sub(reduce(a, tp.data()), reduce(b, tp.data()));
+    }
+
+    mabit_t		mulmod(const mabit_t& a, const mabit_t& b) const
+    {
+      scratch_t		tp = scratch();
+      mabit_t		ret = reduce(a, tp.data());
+      const mabit_t	y = reduce(b, tp.data());
+
+      _barrett.mul(ret._set.data(), ret._set.data(), y._set.data(), tp.data());
+      ret.normalize(size());
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns a ^ exp mod m, like mabit::powmod() without setting up the modulus again
+     */
+    mabit_t		powmod(const mabit_t& a, const mabit_t& exp) const
+    {
+      mabit_t		ret = make();
+
+      if (exp.any() && !exp._sign)
+	{
+	  mabit_t	inverse;
+
+	  return a.invmod(_m, inverse) ? powmod(inverse, exp.abs()) : ret;
+	}
+
+      if (_montgomery)
+	a.exponentiation(ret, *_montgomery, exp);
+      else
+	a.exponentiation(ret, _barrett, exp);
+      return ret;
+    }
+
+    /************************************************************************/
+    /* RESIDUES                                                             */
+    /************************************************************************/
+    mabit_t		to_residue(const mabit_t& a) const
+    {
+      scratch_t		tp = scratch();
+      mabit_t		ret = reduce(a, tp.data());
+
+      // Below m, the conversion has nothing to divide
+      if (_montgomery)
+	{
+	  const mabit_t	x(ret);
+
+	  _montgomery->to_residue(ret._set.data(), x._set.data(), size(), tp.data());
+	  ret.normalize(size());
+	}
+      return ret;
+    }
+
+    mabit_t		from_residue(const mabit_t& x) const
+    {
+      mabit_t		ret = residue(x);
+
+      if (_montgomery)
+	{
+	  scratch_t	tp = scratch();
+
+	  _montgomery->from_residue(ret._set.data(), ret._set.data(), tp.data());
+	  ret.normalize(size());
+	}
+      return ret;
+    }
+
+    mabit_t		mul(const mabit_t& x, const mabit_t& y) const
+    {
+      mabit_t		ret = residue(x);
+      const mabit_t	z = residue(y);
+      scratch_t		tp = scratch();
+
+      if (_montgomery)
+	_montgomery->mul(ret._set.data(), ret._set.data(), z._set.data(), tp.data());
+      else
+	_barrett.mul(ret._set.data(), ret._set.data(), z._set.data(), tp.data());
+      ret.normalize(size());
+      return ret;
+    }
+
+    mabit_t		sqr(const mabit_t& x) const
+    {
+      mabit_t		ret = residue(x);
+      scratch_t		tp = scratch();
+
+      if (_montgomery)
+	_montgomery->sqr(ret._set.data(), ret._set.data(), tp.data());
+      else
+	_barrett.sqr(ret._set.data(), ret._set.data(), tp.data());
+      ret.normalize(size());
+      return ret;
+    }
+
+    // Sums and differences are the same in both forms
+    mabit_t		add(const mabit_t& x, const mabit_t& y) const
+    {
+      const msize_t	n = size();
+      mabit_t		ret = residue(x);
+      const mabit_t	z = residue(y);
+      word_t* const	r = ret._set.data();
+
+      if (kernel_t::add_n(r, r, z._set.data(), n) || kernel_t::cmp(r, _m._set.data(), n) >= 0)
+	kernel_t::sub_n(r, r, _m._set.data(), n);
+      ret.normalize(n);
+      return ret;
+    }
+
+    mabit_t		sub(const mabit_t& x, const mabit_t& y) const
+    {
+      const msize_t	n = size();
+      mabit_t		ret = residue(x);
+      const mabit_t	z = residue(y);
+      word_t* const	r = ret._set.data();
+
+      if (kernel_t::sub_n(r, r, z._set.data(), n))
+	kernel_t::add_n(r, r, _m._set.data(), n);
+      ret.normalize(n);
+      return ret;
+    }
+
+  private:
+    /**
+     ** \brief
+     ** Returns |m|, a null modulus leaving nothing to reduce by
+     */
+    static mabit_t	checked(const mabit_t& m)
+    {
+      if (!m.any())
+	throw std::invalid_argument("Mabit: the modulus should not be null");
+      return m.abs();
+    }
+
+    msize_t		size() const
+    {
+      return _barrett.size();
+    }
+
+    /**
+     ** \brief
+     ** reduce() on the scratch space `tp` of the caller, so that a call makes it only once
+     */
+    mabit_t		reduce(const mabit_t& a, word_t* const tp) const
+    {
+      mabit_t		ret = make();
+
+      _barrett.to_residue(ret._set.data(), a._set.data(), a.used_words(), tp);
+      if (!a._sign)
+	negation(ret);
+      ret.normalize(size());
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns scratch space for either context, Barrett's needing the most
+     */
+    scratch_t		scratch() const
+    {
+      return scratch_t(_barrett.itch());
+    }
+
+    /**
+     ** \brief
+     ** Returns a null number of size() words at least
+     */
+    mabit_t		make() const
+    {
+      mabit_t		ret;
+
+      if (ret.size() < size())
+	ret.resize(size());
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns a copy of the residue `x` (below m), holding size() words at least
+     */
+    mabit_t		residue(const mabit_t& x) const
+    {
+      mabit_t		ret(x);
+
+      if (ret.size() < size())
+	ret.resize(size());
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** x = m - x, unless x is null
+     */
+    void		negation(mabit_t& x) const
+    {
+      word_t* const	r = x._set.data();
+
+      if (kernel_t::normalize(r, size()))
+	kernel_t::sub_n(r, _m._set.data(), r, size());
+    }
+
+    const mabit_t	_m;
+    const barrett_t	_barrett;
+    const std::unique_ptr<montgomery_t>	_montgomery;
+  };
+}
+
+#endif // !MABIT_MODULUS_HPP
@@ -0,0 +1,147 @@
+#ifndef MABIT_MONTGOMERY_HPP
+#define MABIT_MONTGOMERY_HPP
+
+#include <algorithm>					// std::copy, std::fill
+#include <memory>					// std::allocator
+#include <vector>
+#include "mabit_traits.hpp"
+#include "mabit_kernel.hpp"
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Arithmetic modulo an odd number m of n words, in Montgomery form: a stands for a * R mod m, R being 2^(n * BITS_IN_WORD)
+   ** Products are reduced by mabit_kernel::redc(), R^2 mod m being the only division
+   ** Residues are arrays of n words below m, results may be written over the operands
+   ** The context is never written once set up, the scratch space of itch() words being given by the caller as `tp`
+   */
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_montgomery
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef typename kernel_t::scratch_t		scratch_t;
+
+    /**
+     ** \brief
+     ** `m` must be odd and m[n - 1] != 0
+     */
+    mabit_montgomery(word_cp m, const msize_t n)
+      : _m(m, m + n), _minv(static_cast<word_t>(0 - kernel_t::binvert(m[0]))), _r2(n)
+    {
+      scratch_t		power(2 * n + 1, 0);
+      scratch_t		q(n + 2);
+
+      power[2 * n] = 1;
+      kernel_t::divrem(q.data(), _r2.data(), power.data(), 2 * n + 1, m, n);
+    }
+
+    msize_t		size() const
+    {
+      return _m.size();
+    }
+
+    word_cp		modulus() const
+    {
+      return _m.data();
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of words of scratch space the operations below need
+     */
+    msize_t		itch() const
+    {
+      // The product, then the scratch space of the kernel multiplications
+      return 2 * size() + kernel_t::mul_n_itch(size());
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = a[0, an) in Montgomery form, `r` must not overlap `a`
+     */
+    void		to_residue(word_p r, word_cp a, const msize_t an, word_p tp) const
+    {
+      reduce(r, a, an);
+      mul(r, r, _r2.data(), tp);
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = the value standing for the residue a[0, n)
+     */
+    void		from_residue(word_p r, word_cp a, word_p tp) const
+    {
+      const msize_t	n = size();
+
+      std::copy(a, a + n, tp);
+      std::fill(tp + n, tp + 2 * n, 0);
+      kernel_t::redc(r, tp, _m.data(), n, _minv);
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) = 1 in Montgomery form
+     */
+    void		one(word_p r, word_p tp) const
+    {
+      const word_t	w = 1;
+
+      to_residue(r, &w, 1, tp);
+    }
+
+    void		mul(word_p r, word_cp a, word_cp b, word_p tp) const
+    {
+      const msize_t	n = size();
+
+      if (a == b)
+	{
+	  sqr(r, a, tp);
+	  return ;
+	}
+
+      kernel_t::mul_n(tp, a, b, n, tp + 2 * n);
+      kernel_t::redc(r, tp, _m.data(), n, _minv);
+    }
+
+    void		sqr(word_p r, word_cp a, word_p tp) const
+    {
+      const msize_t	n = size();
+
+      kernel_t::sqr_n(tp, a, n, tp + 2 * n);
+      kernel_t::redc(r, tp, _m.data(), n, _minv);
+    }
+
+  private:
+    /**
+     ** \brief
+     ** r[0, n) = a[0, an) mod m
+     */
+    void		reduce(word_p r, word_cp a, const msize_t an) const
+    {
+      const msize_t	n = size();
+
+      if (an < n || (an == n && kernel_t::cmp(a, _m.data(), n) < 0))
+	{
+	  std::copy(a, a + an, r);
+	  std::fill(r + an, r + n, 0);
+	  return ;
+	}
+
+      scratch_t		q(an - n + 1);
+
+      kernel_t::divrem(q.data(), r, a, an, _m.data(), n);
+    }
+
+    scratch_t		_m;
+    word_t		_minv;
+    scratch_t		_r2;
+  };
+}
+
+#endif // !MABIT_MONTGOMERY_HPP
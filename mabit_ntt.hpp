@@ -0,0 +1,428 @@
+#ifndef MABIT_NTT_HPP
+#define MABIT_NTT_HPP
+
+#include <algorithm>					// std::fill, std::max
+#include <cstdint>
+#include <vector>
+#include "mabit_traits.hpp"
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Arithmetic modulo a prime P = c * 2^k + 1 (P < 2^30), G being a primitive root of P
+   ** Holds the number theoretic transforms of length 2^i <= 2^k
+   */
+  template<uint32_t P, uint32_t G>
+  struct mabit_prime
+  {
+    static const uint32_t	MODULUS = P;
+
+    static uint32_t	add(const uint32_t a, const uint32_t b)
+    {
+      const uint32_t	s = a + b;
+
+      return s >= P ? s - P : s;
+    }
+
+    static uint32_t	sub(const uint32_t a, const uint32_t b)
+    {
+      return a >= b ? a - b : a + P - b;
+    }
+
+    static uint32_t	mul(const uint32_t a, const uint32_t b)
+    {
+      return static_cast<uint32_t>(static_cast<uint64_t>(a) * b % P);
+    }
+
+    static uint32_t	pow(uint32_t a, uint64_t e)
+    {
+      uint32_t		ret = 1;
+
+      for (; e; e >>= 1, a = mul(a, a))
+	if (e & 1)
+	  ret = mul(ret, a);
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns floor(w * 2^32 / P)
+     */
+    static uint32_t	quotient(const uint32_t w)
+    {
+      return static_cast<uint32_t>((static_cast<uint64_t>(w) << 32) / P);
+    }
+
+    /**
+     ** \brief
+     ** Returns a * w mod P in [0, 2P), for any a < 2^32, with ws = quotient(w) (Shoup)
+     */
+    static uint32_t	mul_shoup(const uint32_t a, const uint32_t w, const uint32_t ws)
+    {
+      const uint32_t	q = static_cast<uint32_t>((static_cast<uint64_t>(a) * ws) >> 32);
+
+      return a * w - q * P;
+    }
+
+    /**
+     ** \brief
+     ** Returns the twiddle factors of the transforms of length up to `n`
+     ** Level `len` holds the powers of a primitive (2 * len)th root of unity, interleaved with their
+     ** Shoup quotients, at [2 * len, 4 * len). Levels do not depend on `n`, so the table is built once
+     ** per thread and only grown afterwards
+     */
+    static const uint32_t*	roots(const size_t n, const bool inverse)
+    {
+      static thread_local std::vector<uint32_t>	tables[2];
+      std::vector<uint32_t>&			tw = tables[inverse];
+      size_t					len = std::max<size_t>(tw.size() / 2, 1);
+
+      if (tw.size() / 2 >= n)
+	return tw.data();
+
+      tw.resize(2 * n);
+
+      for (; len < n; len <<= 1)
+	{
+	  uint32_t	w = pow(G, (P - 1) / (2 * len));
+
+	  if (inverse)
+	    w = pow(w, P - 2);
+
+	  const uint32_t	ws = quotient(w);
+	  uint32_t		x = 1;
+
+	  for (size_t j = 0; j < len; ++j)
+	    {
+	      tw[2 * (len + j)] = x;
+	      tw[2 * (len + j) + 1] = quotient(x);
+
+	      x = mul_shoup(x, w, ws);
+	      x = x >= P ? x - P : x;
+	    }
+	}
+      return tw.data();
+    }
+
+    /**
+     ** \brief
+     ** Decimation in frequency: natural order in, bit reversed order out
+     ** Values are kept in [0, 2P) along the way (Harvey's lazy butterflies)
+     */
+    static void		forward(uint32_t* a, const size_t n, const uint32_t* tw)
+    {
+      for (size_t len = n / 2; len > 0; len >>= 1)
+	for (size_t i = 0; i < n; i += 2 * len)
+	  {
+	    uint32_t*		x = a + i;
+	    uint32_t*		y = x + len;
+	    const uint32_t*	w = tw + 2 * len;
+
+	    for (size_t j = 0; j < len; ++j)
+	      {
+		const uint32_t	u = x[j];
+		const uint32_t	v = y[j];
+		const uint32_t	s = u + v;
+
+		x[j] = s >= 2 * P ? s - 2 * P : s;
+		y[j] = mul_shoup(u - v + 2 * P, w[2 * j], w[2 * j + 1]);
+	      }
+	  }
+    }
+
+    /**
+     ** \brief
+     ** Decimation in time: bit reversed order in, natural order out (not scaled by 1 / n)
+     ** Values are kept in [0, 4P) along the way and fully reduced at the end
+     */
+    static void		inverse(uint32_t* a, const size_t n, const uint32_t* tw)
+    {
+      for (size_t len = 1; len < n; len <<= 1)
+	for (size_t i = 0; i < n; i += 2 * len)
+	  {
+	    uint32_t*		x = a + i;
+	    uint32_t*		y = x + len;
+	    const uint32_t*	w = tw + 2 * len;
+
+	    for (size_t j = 0; j < len; ++j)
+	      {
+		const uint32_t	u = x[j] >= 2 * P ? x[j] - 2 * P : x[j];
+		const uint32_t	v = mul_shoup(y[j], w[2 * j], w[2 * j + 1]);
+
+		x[j] = u + v;
+		y[j] = u - v + 2 * P;
+	      }
+	  }
+
+      for (size_t i = 0; i < n; ++i)
+	a[i] %= P;
+    }
+
+    /**
+     ** \brief
+     ** fa[0, n) = cyclic convolution of fa and fb (both reduced modulo P), fb is destroyed
+     ** A null `fb` squares fa, saving one forward transform
+     */
+    static void		convolve(uint32_t* fa, uint32_t* fb, const size_t n)
+    {
+      const uint32_t*	tw = roots(n, false);
+
+      forward(fa, n, tw);
+      if (fb)
+	forward(fb, n, tw);
+      else
+	fb = fa;
+
+      const uint32_t	scale = pow(static_cast<uint32_t>(n % P), P - 2);
+
+      for (size_t i = 0; i < n; ++i)
+	fa[i] = mul(mul(fa[i], fb[i]), scale);
+
+      inverse(fa, n, roots(n, true));
+    }
+  };
+
+  /**
+   ** \brief
+   ** Comparisons of products of two 64 bits numbers, usable in constant expressions
+   */
+  struct mabit_wide
+  {
+    /**
+     ** \brief
+     ** Returns the high 64 bits of a * b
+     */
+    static constexpr uint64_t	high(const uint64_t a, const uint64_t b)
+    {
+      return (a >> 32) * (b >> 32) + (((a >> 32) * (b & 0xFFFFFFFF)) >> 32) + (((a & 0xFFFFFFFF) * (b >> 32)) >> 32)
+	+ (((((a >> 32) * (b & 0xFFFFFFFF)) & 0xFFFFFFFF) + (((a & 0xFFFFFFFF) * (b >> 32)) & 0xFFFFFFFF)
+	    + (((a & 0xFFFFFFFF) * (b & 0xFFFFFFFF)) >> 32)) >> 32);
+    }
+
+    /**
+     ** \brief
+     ** Returns whether a * b < c * d
+     */
+    static constexpr bool	less(const uint64_t a, const uint64_t b, const uint64_t c, const uint64_t d)
+    {
+      return high(a, b) < high(c, d) || (high(a, b) == high(c, d) && a * b < c * d);
+    }
+  };
+
+  /**
+   ** \brief
+   ** Multiplication through number theoretic transforms modulo three primes, recombined by CRT
+   ** Operands are cut in 32 bits coefficients whatever the size of `word_t`
+   */
+  template<typename word_t>
+  class mabit_ntt
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+
+    typedef mabit_prime<998244353, 3>			prime1_t;	// 119 * 2^23 + 1
+    typedef mabit_prime<167772161, 3>			prime2_t;	// 5 * 2^25 + 1
+    typedef mabit_prime<469762049, 3>			prime3_t;	// 7 * 2^26 + 1
+
+    static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
+
+    /**
+     ** \brief
+     ** Longest transform of the three primes, which also bounds the coefficients of the product for the CRT
+     ** ca + cb - 1 <= 2^23 gives min(ca, cb) <= 2^22, so that a coefficient, a sum of min(ca, cb) products of two
+     ** 32 bits chunks, is at most 2^22 (2^32 - 1)^2 < 2^86 while p1 p2 p3 is about 2^86.02: 4264960 terms at most would fit
+     */
+    static const msize_t				MAX_LENGTH = static_cast<msize_t>(1) << 23;
+
+    static_assert(mabit_wide::less((MAX_LENGTH + 1) / 2, 0xFFFFFFFFULL * 0xFFFFFFFFULL,
+				   static_cast<uint64_t>(prime1_t::MODULUS) * prime2_t::MODULUS, prime3_t::MODULUS),
+		  "Mabit: NTT coefficients should stay below the product of the three primes");
+    static_assert((prime1_t::MODULUS - 1) % MAX_LENGTH == 0 && (prime2_t::MODULUS - 1) % MAX_LENGTH == 0
+		  && (prime3_t::MODULUS - 1) % MAX_LENGTH == 0, "Mabit: each prime should have roots of unity of order MAX_LENGTH");
+
+    /**
+     ** \brief
+     ** Returns true if a product of `an` by `bn` words can go through the transform
+     */
+    static bool		fits(const msize_t an, const msize_t bn)
+    {
+      return chunks(an) + chunks(bn) - 1 <= MAX_LENGTH;
+    }
+
+    /**
+     ** \brief
+     ** r[0, an + bn) = a[0, an) * b[0, bn), `r` must not overlap the operands
+     */
+    static void		mul(word_p r, word_cp a, const msize_t an, word_cp b, const msize_t bn)
+    {
+      const msize_t	ca = chunks(an);
+      const msize_t	cb = chunks(bn);
+      msize_t		n = 1;
+
+      while (n < ca + cb - 1)
+	n <<= 1;
+
+      std::vector<uint32_t>	raw_a(n), raw_b(n);
+      std::vector<uint32_t>	res(3 * n), tmp(n);
+
+      load(raw_a.data(), a, an, ca);
+      load(raw_b.data(), b, bn, cb);
+
+      transform<prime1_t>(res.data(), raw_a, raw_b, tmp);
+      transform<prime2_t>(res.data() + n, raw_a, raw_b, tmp);
+      transform<prime3_t>(res.data() + 2 * n, raw_a, raw_b, tmp);
+
+      recombine(r, an + bn, res.data(), res.data() + n, res.data() + 2 * n, ca + cb - 1);
+    }
+
+    /**
+     ** \brief
+     ** r[0, 2n) = a[0, n)^2, the same conditions as mul() apply
+     */
+    static void		sqr(word_p r, word_cp a, const msize_t n)
+    {
+      const msize_t	ca = chunks(n);
+      msize_t		len = 1;
+
+      while (len < 2 * ca - 1)
+	len <<= 1;
+
+      std::vector<uint32_t>	raw_a(len);
+      std::vector<uint32_t>	res(3 * len), tmp;
+
+      load(raw_a.data(), a, n, ca);
+
+      transform<prime1_t>(res.data(), raw_a, raw_a, tmp);
+      transform<prime2_t>(res.data() + len, raw_a, raw_a, tmp);
+      transform<prime3_t>(res.data() + 2 * len, raw_a, raw_a, tmp);
+
+      recombine(r, 2 * n, res.data(), res.data() + len, res.data() + 2 * len, 2 * ca - 1);
+    }
+
+  private:
+    static msize_t	chunks(const msize_t n)
+    {
+      return (n * BITS_IN_WORD + 31) / 32;
+    }
+
+    /**
+     ** \brief
+     ** Cuts a[0, an) into `count` coefficients of 32 bits
+     */
+    static void		load(uint32_t* f, word_cp a, const msize_t an, const msize_t count)
+    {
+      if (BITS_IN_WORD >= 32)
+	for (msize_t i = 0; i < count; ++i)
+	  f[i] = static_cast<uint32_t>(a[i * 32 / BITS_IN_WORD] >> (i * 32 % BITS_IN_WORD));
+      else
+	{
+	  const msize_t	ratio = 32 / BITS_IN_WORD;
+
+	  for (msize_t i = 0; i < count; ++i)
+	    {
+	      uint32_t	c = 0;
+
+	      for (msize_t k = 0; k < ratio && i * ratio + k < an; ++k)
+		c |= static_cast<uint32_t>(a[i * ratio + k]) << (k * BITS_IN_WORD);
+	      f[i] = c;
+	    }
+	}
+    }
+
+    /**
+     ** \brief
+     ** Stores the 32 bits coefficient `c` at position `i` of r[0, rn)
+     */
+    static void		store(word_p r, const msize_t rn, const msize_t i, const uint32_t c)
+    {
+      if (BITS_IN_WORD >= 32)
+	{
+	  if (i * 32 / BITS_IN_WORD < rn)
+	    r[i * 32 / BITS_IN_WORD] |= static_cast<word_t>(static_cast<word_t>(c) << (i * 32 % BITS_IN_WORD));
+	}
+      else
+	{
+	  const msize_t	ratio = 32 / BITS_IN_WORD;
+
+	  for (msize_t k = 0; k < ratio && i * ratio + k < rn; ++k)
+	    r[i * ratio + k] = static_cast<word_t>(c >> (k * BITS_IN_WORD));
+	}
+    }
+
+    /**
+     ** \brief
+     ** out[0, n) = convolution of the coefficients modulo the prime of `prime_t`
+     ** Passing the same vector twice squares it, `tmp` is then left untouched
+     */
+    template<typename prime_t>
+    static void		transform
+    (
+     uint32_t* out,
+     const std::vector<uint32_t>& raw_a,
+     const std::vector<uint32_t>& raw_b,
+     std::vector<uint32_t>& tmp
+     )
+    {
+      const size_t	n = raw_a.size();
+
+      if (&raw_a == &raw_b)
+	{
+	  for (size_t i = 0; i < n; ++i)
+	    out[i] = raw_a[i] % prime_t::MODULUS;
+	  prime_t::convolve(out, 0, n);
+	  return ;
+	}
+
+      for (size_t i = 0; i < n; ++i)
+	{
+	  out[i] = raw_a[i] % prime_t::MODULUS;
+	  tmp[i] = raw_b[i] % prime_t::MODULUS;
+	}
+      prime_t::convolve(out, tmp.data(), n);
+    }
+
+    /**
+     ** \brief
+     ** Rebuilds each coefficient from its three residues (Garner), then propagates the carries into r[0, rn)
+     */
+    static void		recombine(word_p r, const msize_t rn, const uint32_t* r1, const uint32_t* r2, const uint32_t* r3, const msize_t count)
+    {
+      static const uint64_t	p1 = prime1_t::MODULUS;
+      static const uint64_t	p12 = p1 * prime2_t::MODULUS;
+      static const uint32_t	inv_p1 = prime2_t::pow(prime1_t::MODULUS % prime2_t::MODULUS, prime2_t::MODULUS - 2);
+      static const uint32_t	inv_p12 = prime3_t::pow(p12 % prime3_t::MODULUS, prime3_t::MODULUS - 2);
+      const msize_t		total = chunks(rn);
+      uint64_t			lo = 0;
+      uint64_t			hi = 0;
+
+      std::fill(r, r + rn, 0);
+
+      for (msize_t i = 0; i < total; ++i)
+	{
+	  if (i < count)
+	    {
+	      // x12 = x mod p1 * p2, then x = x12 + p1 * p2 * t (up to 86 bits)
+	      const uint32_t	t1 = prime2_t::mul(prime2_t::sub(r2[i], r1[i] % prime2_t::MODULUS), inv_p1);
+	      const uint64_t	x12 = r1[i] + p1 * t1;
+	      const uint32_t	t2 = prime3_t::mul(prime3_t::sub(r3[i], x12 % prime3_t::MODULUS), inv_p12);
+	      const uint64_t	mid = (p12 >> 32) * t2;
+	      const uint64_t	low = x12 + (p12 & 0xFFFFFFFFU) * t2;
+	      const uint64_t	add_lo = low + (mid << 32);
+
+	      hi += (mid >> 32) + (add_lo < low);
+	      lo += add_lo;
+	      hi += lo < add_lo;
+	    }
+
+	  store(r, rn, i, static_cast<uint32_t>(lo));
+	  lo = (lo >> 32) | (hi << 32);
+	  hi >>= 32;
+	}
+    }
+  };
+}
+
+#endif // !MABIT_NTT_HPP
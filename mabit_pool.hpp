@@ -0,0 +1,183 @@
+#ifndef MABIT_POOL_HPP
+#define MABIT_POOL_HPP
+
+#include <cstddef>					// size_t
+#include <new>						// operator new, operator delete
+
+// Blocks kept aside by each size class of a thread's pool
+#ifndef MABIT_POOL_DEPTH
+# define MABIT_POOL_DEPTH		16
+#endif
+
+// Biggest block (log2 of its size in bytes) going through the pool, bigger ones go straight to operator new
+#ifndef MABIT_POOL_MAX_SHIFT
+# define MABIT_POOL_MAX_SHIFT		20
+#endif
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Per thread cache of memory blocks, sorted by power of two size classes
+   ** Released blocks are kept on a free list threaded through the blocks themselves, up to MABIT_POOL_DEPTH of each size
+   ** Blocks may be released by another thread than the one which got them, they then join that thread's pool
+   */
+  class mabit_pool
+  {
+  public:
+    static const size_t		MIN_SHIFT = sizeof(void*) == 8 ? 3 : 2;
+    static const size_t		MAX_SHIFT = MABIT_POOL_MAX_SHIFT;
+    static const size_t		DEPTH = MABIT_POOL_DEPTH;
+
+    static_assert(MAX_SHIFT >= MIN_SHIFT && MAX_SHIFT < sizeof(size_t) * 8, "Mabit: pool max shift out of range");
+
+    /**
+     ** \brief
+     ** Returns a block of at least `bytes` bytes
+     */
+    static void*		allocate(const size_t bytes)
+    {
+      const size_t		shift = size_class(bytes);
+
+      if (shift > MAX_SHIFT)
+	return ::operator new(bytes);
+
+      mabit_pool* const		pool = local();
+
+      if (pool && pool->_free[shift])
+	{
+	  block* const		b = pool->_free[shift];
+
+	  pool->_free[shift] = b->next;
+	  --pool->_count[shift];
+	  return b;
+	}
+      return ::operator new(static_cast<size_t>(1) << shift);
+    }
+
+    /**
+     ** \brief
+     ** Gives back a block got from allocate() with the same `bytes`
+     */
+    static void			deallocate(void* const p, const size_t bytes)
+    {
+      const size_t		shift = size_class(bytes);
+      mabit_pool* const		pool = shift > MAX_SHIFT ? nullptr : local();
+
+      if (!pool || pool->_count[shift] >= DEPTH)
+	{
+	  ::operator delete(p);
+	  return ;
+	}
+
+      block* const		b = static_cast<block*>(p);
+
+      b->next = pool->_free[shift];
+      pool->_free[shift] = b;
+      ++pool->_count[shift];
+    }
+
+  private:
+    struct			block
+    {
+      block*			next;
+    };
+
+    block*			_free[MAX_SHIFT + 1];
+    size_t			_count[MAX_SHIFT + 1];
+    bool&			_released;
+
+    explicit mabit_pool(bool& released) : _released(released)
+    {
+      for (size_t i = 0; i <= MAX_SHIFT; ++i)
+	{
+	  _free[i] = nullptr;
+	  _count[i] = 0;
+	}
+    }
+
+    ~mabit_pool()
+    {
+      for (size_t i = 0; i <= MAX_SHIFT; ++i)
+	while (_free[i])
+	  {
+	    block* const	b = _free[i];
+
+	    _free[i] = b->next;
+	    ::operator delete(b);
+	  }
+      _released = true;
+    }
+
+    mabit_pool(const mabit_pool&) = delete;
+    mabit_pool&			operator = (const mabit_pool&) = delete;
+
+    /**
+     ** \brief
+     ** Returns the pool of the calling thread, null once the thread is being torn down
+     */
+    static mabit_pool*		local()
+    {
+      static thread_local bool		released = false;
+      static thread_local mabit_pool	pool(released);
+
+      return released ? nullptr : &pool;
+    }
+
+    /**
+     ** \brief
+     ** Returns log2 of the smallest block size holding `bytes`
+     */
+    static size_t		size_class(const size_t bytes)
+    {
+      if (bytes <= (static_cast<size_t>(1) << MIN_SHIFT))
+	return MIN_SHIFT;
+      return sizeof(unsigned long long) * 8 - __builtin_clzll(static_cast<unsigned long long>(bytes - 1));
+    }
+  };
+
+  /**
+   ** \brief
+   ** Stateless allocator drawing from the calling thread's mabit_pool
+   ** e.g : mabit<unsigned int, mabit_pool_allocator<unsigned int> >
+   */
+  template<typename T>
+  class mabit_pool_allocator
+  {
+  public:
+    typedef T			value_type;
+
+    mabit_pool_allocator()
+    {
+    }
+
+    template<typename U>
+    mabit_pool_allocator(const mabit_pool_allocator<U>&)
+    {
+    }
+
+    T*				allocate(const size_t n)
+    {
+      return static_cast<T*>(mabit_pool::allocate(n * sizeof(T)));
+    }
+
+    void			deallocate(T* const p, const size_t n)
+    {
+      mabit_pool::deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool			operator == (const mabit_pool_allocator<U>&) const
+    {
+      return true;
+    }
+
+    template<typename U>
+    bool			operator != (const mabit_pool_allocator<U>&) const
+    {
+      return false;
+    }
+  };
+}
+
+#endif // !MABIT_POOL_HPP
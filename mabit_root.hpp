@@ -0,0 +1,464 @@
+#ifndef MABIT_ROOT_HPP
+#define MABIT_ROOT_HPP
+
+#include <utility>					// std::move
+#include <vector>
+#include "mabit_traits.hpp"
+#include "mabit.hpp"
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Integer roots of magnitudes and perfect power tests
+   ** Square roots come with their remainder out of Zimmermann's Karatsuba square root, n-th roots out of Newton's iteration,
+   ** both recursing on the leading half of the bits so that the last step, at full size, starts from half the root
+   */
+  template<typename word_t, typename alloc_t>
+  class mabit_root
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
+    typedef mabit<word_t, alloc_t>			mabit_t;
+
+    static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
+
+    /**
+     ** \brief
+     ** Stores inside `s` and `r` the square root of |a| and the remainder: s = floor(sqrt(|a|)), r = |a| - s^2
+     */
+    static void		sqrtrem(const mabit_t& a, mabit_t& s, mabit_t& r)
+    {
+      const msize_t	bits = a.used_bits();
+
+      if (!bits)
+	{
+	  s = mabit_t();
+	  r = mabit_t();
+	  return ;
+	}
+
+      // An even number of bits, the leading two of which are not both null
+      karatsuba_sqrtrem(a.abs(), bits + (bits & 1), s, r);
+    }
+
+    /**
+     ** \brief
+     ** Returns floor(|a| ^ (1 / n)), `n` being non null
+     */
+    static mabit_t	root(const mabit_t& a, const msize_t n)
+    {
+      const msize_t	bits = a.used_bits();
+
+      if (n == 2)
+	{
+	  mabit_t	s;
+	  mabit_t	r;
+
+	  sqrtrem(a, s, r);
+	  return s;
+	}
+      if (n == 1 || bits <= 1)
+	return a.abs();
+      // Below 2^n, the root is 1
+      if (bits <= n)
+	return mabit_t(1);
+
+      // The root fits ceil(bits / n) bits, the leading half of them is the root of the leading bits
+      const msize_t	t = (bits + n - 1) / n / 2;
+      const mabit_t	m = a.abs();
+      mabit_t		x = root(m.extract_bits(t * n, bits), n);
+
+      ++x;
+      x = shifted(x, t);
+
+      // Started above the root, Newton's iteration decreases down to its floor, where x^n <= m tells to stop
+      for (;;)
+	{
+	  const mabit_t	p = power(x, n - 1);
+
+	  if (x * p <= m)
+	    return x;
+
+	  mabit_t	y = m / p;
+
+	  y += x * mabit_t(n - 1);
+	  y /= mabit_t(n);
+	  x = std::move(y);
+	}
+    }
+
+    /**
+     ** \brief
+     ** Returns whether a is the square of an integer
+     */
+    static bool		is_square(const mabit_t& a)
+    {
+      if (!a.any())
+	return true;
+      if (!a._sign)
+	return false;
+
+      // Squares are 4^k times 1 mod 8
+      const msize_t	z = a.count_trailing_zeros();
+
+      if ((z & 1) || a.get_bit(z + 1) || a.get_bit(z + 2))
+	return false;
+      if (!is_power_residue(residue(a), 2))
+	return false;
+
+      mabit_t		s;
+      mabit_t		r;
+
+      sqrtrem(a, s, r);
+      return !r.any();
+    }
+
+    /**
+     ** \brief
+     ** Returns whether a = x^k for some integers x and k >= 2, which holds for 0, 1 and -1
+     */
+    static bool		is_power(const mabit_t& a)
+    {
+      static const unsigned	SMALL_PRIMES[] = { 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97,
+					   101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193,
+					   197, 199, 211, 223, 227, 229, 233, 239, 241, 251 };
+      static const msize_t	COUNT = sizeof(SMALL_PRIMES) / sizeof(SMALL_PRIMES[0]);
+      const word_t		word_max = static_cast<word_t>(~static_cast<word_t>(0));
+      const mabit_t		m = a.abs();
+
+      if (m.used_bits() <= 1)
+	return true;
+      // x^k is x'^p for any prime p dividing k, negative values need an odd one
+      if (a._sign && is_square(m))
+	return true;
+
+      // p has to divide the multiplicity of every prime factor, g being their gcd (0 while none is known)
+      const msize_t		z = m.count_trailing_zeros();
+      msize_t			g = z;
+      mabit_t			c(m);
+      mabit_t			q;
+
+      c >>= z;
+
+      // Small factors are divided out, the primes being tried by groups whose product fits a word
+      for (msize_t i = 0; i < COUNT; )
+	{
+	  word_t		product = 1;
+	  msize_t		j = i;
+
+	  for (; j < COUNT && product <= word_max / SMALL_PRIMES[j]; ++j)
+	    product = static_cast<word_t>(product * SMALL_PRIMES[j]);
+
+	  const word_t		r = c.divmod(product, q);
+
+	  for (; i < j; ++i)
+	    if (r % SMALL_PRIMES[i] == 0)
+	      {
+		const word_t	f = static_cast<word_t>(SMALL_PRIMES[i]);
+		msize_t		e = 0;
+
+		for (; !c.divmod(f, q); ++e)
+		  c = std::move(q);
+		g = gcd(g, e);
+		if (g == 1)
+		  return false;
+	      }
+	}
+
+      // c being free of factors below 256, its root is above 2^8
+      const msize_t		bits = c.used_bits();
+      const msize_t		bound = bits > 1 ? (bits - 1) / 8 : g;
+      const msize_t		last = g && g < bound ? g : bound;
+      const unsigned long long	residue_c = residue(c);
+      std::vector<bool>		composite(last + 1, false);
+
+      for (msize_t p = 3; p <= last; p += 2)
+	{
+	  if (composite[p])
+	    continue;
+	  for (msize_t i = p * p; i <= last; i += 2 * p)
+	    composite[i] = true;
+
+	  if (g % p)
+	    continue;
+	  if (bits == 1)
+	    return true;
+	  if (!is_power_residue(residue_c, p))
+	    continue;
+
+	  // The root would be odd, below 2^b, thus equal to the 2-adic root of c
+	  const msize_t		b = (bits + p - 1) / p;
+	  const mabit_t		r = adic_root(c, p, b);
+	  const msize_t		r_bits = r.used_bits();
+
+	  if ((r_bits - 1) * p >= bits || r_bits * p < bits || !is_power_of(residue(r), residue_c, p))
+	    continue;
+	  if (power(r, p) == c)
+	    return true;
+	}
+      return false;
+    }
+
+  private:
+    /**
+     ** \brief
+     ** Zimmermann's Karatsuba square root of `a`, whose `bits` bits are even in number and whose leading two are not both null
+     ** a = ah 4^l + a1 2^l + a0, the root s' of ah gives the root by dividing (r' 2^l + a1) by 2s', l being bits / 4
+     */
+    static void		karatsuba_sqrtrem(const mabit_t& a, const msize_t bits, mabit_t& s, mabit_t& r)
+    {
+      if (bits <= 2 * BITS_IN_WORD)
+	{
+	  const dword_t	x = a.template to_integer<dword_t>();
+	  dword_t	y = static_cast<dword_t>(1) << (bits / 2);
+	  dword_t	root;
+
+	  // Newton's iteration from 2^(bits / 2), above the root
+	  do
+	    {
+	      root = y;
+	      y = (root + x / root) / 2;
+	    }
+	  while (y < root);
+
+	  s = from_dword(root);
+	  r = from_dword(x - root * root);
+	  return ;
+	}
+
+      const msize_t	l = bits / 4;
+      mabit_t		s1;
+      mabit_t		r1;
+      mabit_t		q;
+      mabit_t		u;
+
+      karatsuba_sqrtrem(a.extract_bits(2 * l, bits), bits - 2 * l, s1, r1);
+
+      const mabit_t	n = shifted(r1, l) + a.extract_bits(l, 2 * l);
+
+      n.divmod(shifted(s1, 1), q, u);
+      s = shifted(s1, l) + q;
+      r = shifted(u, l) + a.extract_bits(0, l) - q.square();
+
+      // s is one too big at most: (s - 1)^2 = s^2 - 2s + 1
+      while (!r._sign)
+	{
+	  r += s;
+	  --s;
+	  r += s;
+	}
+    }
+
+    /**
+     ** \brief
+     ** Returns the root of the odd number `o` in the 2-adic integers, modulo 2^b, `p` being odd
+     ** Newton's iteration y += y (1 - o y^p) / p finds o^(-1/p), doubling the number of right bits each time, the root being o y^(p - 1)
+     */
+    static mabit_t	adic_root(const mabit_t& o, const msize_t p, const msize_t b)
+    {
+      static const msize_t	LOW = sizeof(unsigned long long) * 8;
+
+      // The first 64 bits wrap around in native integers, o^(p + 1) = 1 mod 8 and p^2 = 1 mod 8 giving 3 right bits to start from
+      const unsigned long long	low = o.extract_bits(0, LOW).template to_integer<unsigned long long>();
+      const unsigned long long	p_low = p;
+      unsigned long long	y = low;
+      unsigned long long	p_inv = p_low;
+
+      for (unsigned k = 3; k < LOW; k *= 2)
+	{
+	  p_inv *= 2 - p_low * p_inv;
+	  y *= (p_low + 1 - low * native_power(y, p)) * p_inv;
+	}
+
+      if (b <= LOW)
+	{
+	  const unsigned long long	root = low * native_power(y, p - 1);
+
+	  return mabit_t(b < LOW ? root & ((1ULL << b) - 1) : root);
+	}
+
+      // Then mabit ones are cut to the bits which are right
+      std::vector<msize_t>	steps;
+      mabit_t			y_big(y);
+      mabit_t			p_big(p_inv);
+
+      for (msize_t k = b; k > LOW; k = (k + 1) / 2)
+	steps.push_back(k);
+
+      for (msize_t i = steps.size(); i > 0; --i)
+	{
+	  const msize_t	k = steps[i - 1];
+	  mabit_t	e = power(y_big, p, k) * o.extract_bits(0, k);
+	  mabit_t	f = p_big * mabit_t(p);
+
+	  // p^-1 gets right up to k bits first: z (2 - p z)
+	  p_big *= complement(f.extract_bits(0, k), 2, k);
+	  p_big = p_big.extract_bits(0, k);
+	  e = complement(e.extract_bits(0, k), 1, k) + mabit_t(p);
+	  y_big *= e.extract_bits(0, k);
+	  y_big = y_big.extract_bits(0, k);
+	  y_big *= p_big;
+	  y_big = y_big.extract_bits(0, k);
+	}
+
+      mabit_t		root = power(y_big, p - 1, b) * o.extract_bits(0, b);
+
+      return root.extract_bits(0, b);
+    }
+
+    /**
+     ** \brief
+     ** Returns x^n, modulo 2^k if `k` is not null, `n` being non null
+     */
+    static mabit_t	power(const mabit_t& x, const msize_t n, const msize_t k = 0)
+    {
+      mabit_t		ret = k ? x.extract_bits(0, k) : x;
+      msize_t		mask = 1;
+
+      while (mask <= n / 2)
+	mask <<= 1;
+      while (mask >>= 1)
+	{
+	  ret = ret.square();
+	  if (n & mask)
+	    ret *= x;
+	  if (k)
+	    ret = ret.extract_bits(0, k);
+	}
+      return ret;
+    }
+
+    static unsigned long long	native_power(unsigned long long x, msize_t n)
+    {
+      unsigned long long	ret = 1;
+
+      for (; n; n >>= 1, x *= x)
+	if (n & 1)
+	  ret *= x;
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns (c - x) mod 2^k, `x` being below 2^k and `c` below x + 2^k
+     */
+    static mabit_t	complement(const mabit_t& x, const unsigned c, const msize_t k)
+    {
+      mabit_t		ret(c);
+
+      ret -= x;
+      if (!ret._sign)
+	{
+	  mabit_t	modulus;
+
+	  modulus.resize(modulus.word_ceil(k + 1));
+	  modulus.set_bit(k, true);
+	  ret += modulus;
+	}
+      return ret;
+    }
+
+    static mabit_t	shifted(const mabit_t& x, const msize_t shift)
+    {
+      mabit_t		ret(x);
+      const msize_t	words = ret.word_ceil(ret.used_bits() + shift);
+
+      if (ret.size() < words)
+	ret.resize(words);
+      ret <<= shift;
+      return ret;
+    }
+
+    /************************************************************************/
+    /* RESIDUE FILTERS                                                      */
+    /************************************************************************/
+    /**
+     ** \brief
+     ** Returns |x| mod 2^48 - 1 = 3^2 5 7 13 17 97 241 257 673, in a single pass without any division
+     */
+    static unsigned long long	residue(const mabit_t& x)
+    {
+      static const unsigned long long	MASK = (1ULL << 48) - 1;
+      static const unsigned		ROTATION = BITS_IN_WORD % 48;
+      unsigned long long		ret = 0;
+
+      for (msize_t i = x.used_words(); i > 0; --i)
+	{
+	  const unsigned long long	w = x._set[i - 1];
+
+	  // Multiplying by 2^48 = 1 is a rotation, 2^W being 2^(W mod 48)
+	  ret = ((ret << ROTATION) & MASK) | (ret >> (48 - ROTATION));
+	  ret += (w & MASK) + (w >> 48);
+	  ret = (ret & MASK) + (ret >> 48);
+	  ret = (ret & MASK) + (ret >> 48);
+	}
+      return ret % MASK;
+    }
+
+    /**
+     ** \brief
+     ** Returns whether the number of residue `x` modulo 2^48 - 1 can be a p-th power modulo each prime factor of 2^48 - 1
+     ** When p divides q - 1, p-th powers modulo q are 0 and the x such that x^((q - 1) / p) = 1
+     */
+    static bool		is_power_residue(const unsigned long long x, const msize_t p)
+    {
+      static const unsigned	FACTORS[] = { 3, 5, 7, 13, 17, 97, 241, 257, 673 };
+
+      for (const unsigned q : FACTORS)
+	if ((q - 1) % p == 0 && x % q && modular_power(x % q, (q - 1) / p, q) != 1)
+	  return false;
+      return true;
+    }
+
+    /**
+     ** \brief
+     ** Returns whether r^p = x modulo each prime factor of 2^48 - 1, `r` and `x` being residues modulo 2^48 - 1
+     */
+    static bool		is_power_of(const unsigned long long r, const unsigned long long x, const msize_t p)
+    {
+      static const unsigned	FACTORS[] = { 3, 5, 7, 13, 17, 97, 241, 257, 673 };
+
+      for (const unsigned q : FACTORS)
+	if (modular_power(r % q, p, q) != x % q)
+	  return false;
+      return true;
+    }
+
+    static unsigned long long	modular_power(unsigned long long x, msize_t n, const unsigned q)
+    {
+      unsigned long long	ret = 1;
+
+      for (; n; n >>= 1, x = x * x % q)
+	if (n & 1)
+	  ret = ret * x % q;
+      return ret;
+    }
+
+    static msize_t	gcd(msize_t x, msize_t y)
+    {
+      while (y)
+	{
+	  const msize_t	r = x % y;
+
+	  x = y;
+	  y = r;
+	}
+      return x;
+    }
+
+    static mabit_t	from_dword(const dword_t x)
+    {
+      mabit_t		ret;
+
+      ret.resize(2 < mabit_t::MIN_SIZE ? mabit_t::MIN_SIZE : 2);
+      ret._set[0] = static_cast<word_t>(x);
+      ret._set[1] = static_cast<word_t>(x >> BITS_IN_WORD);
+      ret.normalize(2);
+      return ret;
+    }
+  };
+}
+
+#endif // !MABIT_ROOT_HPP
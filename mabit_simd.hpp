@@ -0,0 +1,784 @@
+#ifndef MABIT_SIMD_HPP
+#define MABIT_SIMD_HPP
+
+#include <algorithm>					// std::fill
+#include <cstddef>					// size_t, ptrdiff_t
+#include <cstdint>
+#include <cstring>					// std::memcpy, std::memmove, std::memset
+#include "mabit_traits.hpp"
+
+// Arrays (in bytes) from which the vector kernels are dispatched, shorter ones stay on the portable loops
+#ifndef MABIT_SIMD_THRESHOLD
+# define MABIT_SIMD_THRESHOLD		64
+#endif
+
+// Vector kernels are picked at run time on x86 (GCC, Clang), defining MABIT_NO_SIMD keeps the portable loops only
+#if !defined(MABIT_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define MABIT_SIMD_X86
+# include <immintrin.h>
+#endif
+
+// Words of a little endian array form a single bit string whatever their size, so shifts may work on bytes
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define MABIT_SIMD_LITTLE_ENDIAN
+#endif
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Bitwise kernels on raw arrays of bytes, AVX-512, AVX2 or SSE2 ones being chosen once per process
+   ** Bytes are combined in 64 bits lanes by the portable loops, which handle the tails of the vector ones
+   ** Bits are counted by AVX-512 VPOPCNTDQ, AVX2 nibble lookups or the POPCNT instruction
+   */
+  class mabit_simd_bytes
+  {
+  public:
+    enum
+      {
+	AND,
+	OR,
+	XOR,
+	ANDNOT
+      };
+
+    static const size_t		THRESHOLD = MABIT_SIMD_THRESHOLD;
+
+    /**
+     ** \brief
+     ** r[0, n) = r[0, n) op a[0, n), ANDNOT clearing the bits set in `a`
+     */
+    template<unsigned op>
+    static void			binary(unsigned char* r, const unsigned char* a, const size_t n)
+    {
+      if (n < THRESHOLD)
+	binary_portable<op>(r, a, n);
+      else
+	kernels().binary[op](r, a, n);
+    }
+
+    static void			bit_not(unsigned char* r, const size_t n)
+    {
+      if (n < THRESHOLD)
+	not_portable(r, n);
+      else
+	kernels().bit_not(r, n);
+    }
+
+    /**
+     ** \brief
+     ** Repeats the 8 bytes of `pattern` over r[0, n)
+     */
+    static void			fill(unsigned char* r, const size_t n, const uint64_t pattern)
+    {
+      if (n < THRESHOLD)
+	fill_portable(r, n, pattern);
+      else
+	kernels().fill(r, n, pattern);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of bits set in a[0, n)
+     */
+    static size_t		popcount(const unsigned char* a, const size_t n)
+    {
+      if (n < THRESHOLD)
+	return popcount_portable(a, n);
+      return kernels().popcount(a, n);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number of bits which differ between a[0, n) and b[0, n)
+     */
+    static size_t		hamming(const unsigned char* a, const unsigned char* b, const size_t n)
+    {
+      if (n < THRESHOLD)
+	return hamming_portable(a, b, n);
+      return kernels().hamming(a, b, n);
+    }
+
+    /**
+     ** \brief
+     ** Shifts the little endian bit string r[0, n) by `shift` bits toward its most significant end
+     ** with 0 < shift < 8 * n, bits going past the end are lost
+     */
+    static void			lshift(unsigned char* r, const size_t n, const size_t shift)
+    {
+      if (!(shift % 8))
+	{
+	  std::memmove(r + shift / 8, r, n - shift / 8);
+	  std::memset(r, 0, shift / 8);
+	}
+      else if (n < THRESHOLD)
+	lshift_portable(r, n, shift / 8, shift % 8);
+      else
+	kernels().lshift(r, n, shift / 8, shift % 8);
+    }
+
+    /**
+     ** \brief
+     ** Shifts the little endian bit string r[0, n) by `shift` bits toward its least significant end
+     ** with 0 < shift < 8 * n
+     */
+    static void			rshift(unsigned char* r, const size_t n, const size_t shift)
+    {
+      if (!(shift % 8))
+	{
+	  std::memmove(r, r + shift / 8, n - shift / 8);
+	  std::memset(r + n - shift / 8, 0, shift / 8);
+	}
+      else if (n < THRESHOLD)
+	rshift_portable(r, n, shift / 8, shift % 8);
+      else
+	kernels().rshift(r, n, shift / 8, shift % 8);
+    }
+
+  private:
+    struct			table
+    {
+      void			(*binary[4])(unsigned char*, const unsigned char*, size_t);
+      void			(*bit_not)(unsigned char*, size_t);
+      void			(*fill)(unsigned char*, size_t, uint64_t);
+      void			(*lshift)(unsigned char*, size_t, size_t, unsigned);
+      void			(*rshift)(unsigned char*, size_t, size_t, unsigned);
+      size_t			(*popcount)(const unsigned char*, size_t);
+      size_t			(*hamming)(const unsigned char*, const unsigned char*, size_t);
+    };
+
+    static const table&		kernels()
+    {
+      static const table	t = select();
+
+      return t;
+    }
+
+    // Each kernel is taken from the widest instruction set the processor runs
+    static table		select()
+    {
+      table			t = { { binary_portable<AND>, binary_portable<OR>, binary_portable<XOR>, binary_portable<ANDNOT> },
+				      not_portable, fill_portable, lshift_portable, rshift_portable,
+				      popcount_portable, hamming_portable };
+
+#ifdef MABIT_SIMD_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("sse2"))
+	{
+	  const table		sse2 = { { binary_sse2<AND>, binary_sse2<OR>, binary_sse2<XOR>, binary_sse2<ANDNOT> },
+					 not_sse2, fill_sse2, lshift_sse2, rshift_sse2, t.popcount, t.hamming };
+	  t = sse2;
+	}
+      if (__builtin_cpu_supports("popcnt"))
+	{
+	  t.popcount = popcount_popcnt;
+	  t.hamming = hamming_popcnt;
+	}
+      if (__builtin_cpu_supports("avx2"))
+	{
+	  const table		avx2 = { { binary_avx2<AND>, binary_avx2<OR>, binary_avx2<XOR>, binary_avx2<ANDNOT> },
+					 not_avx2, fill_avx2, lshift_avx2, rshift_avx2, popcount_avx2, hamming_avx2 };
+	  t = avx2;
+	}
+      if (__builtin_cpu_supports("avx512f"))
+	{
+	  const table		avx512 = { { binary_avx512<AND>, binary_avx512<OR>, binary_avx512<XOR>, binary_avx512<ANDNOT> },
+					   not_avx512, fill_avx512, lshift_avx512, rshift_avx512, t.popcount, t.hamming };
+	  t = avx512;
+	}
+      if (__builtin_cpu_supports("avx512vpopcntdq"))
+	{
+	  t.popcount = popcount_avx512;
+	  t.hamming = hamming_avx512;
+	}
+#endif
+      return t;
+    }
+
+    /************************************************************************/
+    /* PORTABLE LOOPS                                                       */
+    /************************************************************************/
+    static uint64_t		load(const unsigned char* p)
+    {
+      uint64_t			v;
+
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    static void			store(unsigned char* p, const uint64_t v)
+    {
+      std::memcpy(p, &v, sizeof(v));
+    }
+
+    template<unsigned op, typename T>
+    static T			combine(const T a, const T b)
+    {
+      return static_cast<T>(op == AND ? a & b : op == OR ? a | b : op == XOR ? a ^ b : a & ~b);
+    }
+
+    template<unsigned op>
+    static void			binary_portable(unsigned char* r, const unsigned char* a, const size_t n)
+    {
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	store(r + i, combine<op>(load(r + i), load(a + i)));
+      for (; i < n; ++i)
+	r[i] = combine<op>(r[i], a[i]);
+    }
+
+    static void			not_portable(unsigned char* r, const size_t n)
+    {
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	store(r + i, ~load(r + i));
+      for (; i < n; ++i)
+	r[i] = static_cast<unsigned char>(~r[i]);
+    }
+
+    static void			fill_portable(unsigned char* r, const size_t n, const uint64_t pattern)
+    {
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	store(r + i, pattern);
+      if (i < n)
+	std::memcpy(r + i, &pattern, n - i);
+    }
+
+    // Byte `k` of r[0, n), zero outside of it
+    static unsigned		byte_at(const unsigned char* r, const size_t n, const ptrdiff_t k)
+    {
+      return k < 0 || static_cast<size_t>(k) >= n ? 0 : r[k];
+    }
+
+    /**
+     ** \brief
+     ** Left shift by `bytes` bytes and 0 < `bits` < 8 bits, of which r[top, n) is already done
+     ** Lanes are built from the source lane and the one below it, going down so that the source is still unread
+     */
+    static void			lshift_from(unsigned char* r, const size_t n, size_t top, const size_t bytes, const unsigned bits)
+    {
+      const ptrdiff_t		b = static_cast<ptrdiff_t>(bytes);
+
+      for (; top >= bytes + 16; top -= 8)
+	store(r + top - 8, (load(r + top - 8 - bytes) << bits) | (load(r + top - 16 - bytes) >> (64 - bits)));
+      for (ptrdiff_t j = static_cast<ptrdiff_t>(top) - 1; j >= 0; --j)
+	r[j] = static_cast<unsigned char>((byte_at(r, n, j - b) << bits) | (byte_at(r, n, j - b - 1) >> (8 - bits)));
+    }
+
+    /**
+     ** \brief
+     ** Right shift by `bytes` bytes and 0 < `bits` < 8 bits, of which r[0, bottom) is already done
+     */
+    static void			rshift_from(unsigned char* r, const size_t n, size_t bottom, const size_t bytes, const unsigned bits)
+    {
+      for (; bottom + bytes + 16 <= n; bottom += 8)
+	store(r + bottom, (load(r + bottom + bytes) >> bits) | (load(r + bottom + bytes + 8) << (64 - bits)));
+      for (size_t j = bottom; j < n; ++j)
+	r[j] = static_cast<unsigned char>((byte_at(r, n, static_cast<ptrdiff_t>(j + bytes)) >> bits)
+					  | (byte_at(r, n, static_cast<ptrdiff_t>(j + bytes + 1)) << (8 - bits)));
+    }
+
+    static void			lshift_portable(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      lshift_from(r, n, n, bytes, bits);
+    }
+
+    static void			rshift_portable(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      rshift_from(r, n, 0, bytes, bits);
+    }
+
+    static size_t		popcount_portable(const unsigned char* a, const size_t n)
+    {
+      size_t			count = 0;
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	count += __builtin_popcountll(load(a + i));
+      for (; i < n; ++i)
+	count += __builtin_popcount(a[i]);
+      return count;
+    }
+
+    static size_t		hamming_portable(const unsigned char* a, const unsigned char* b, const size_t n)
+    {
+      size_t			count = 0;
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	count += __builtin_popcountll(load(a + i) ^ load(b + i));
+      for (; i < n; ++i)
+	count += __builtin_popcount(a[i] ^ b[i]);
+      return count;
+    }
+
+#ifdef MABIT_SIMD_X86
+    /************************************************************************/
+    /* POPCNT                                                               */
+    /************************************************************************/
+    __attribute__((target("popcnt")))
+    static size_t		popcount_popcnt(const unsigned char* a, const size_t n)
+    {
+      size_t			count = 0;
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	count += __builtin_popcountll(load(a + i));
+      return count + popcount_portable(a + i, n - i);
+    }
+
+    __attribute__((target("popcnt")))
+    static size_t		hamming_popcnt(const unsigned char* a, const unsigned char* b, const size_t n)
+    {
+      size_t			count = 0;
+      size_t			i = 0;
+
+      for (; i + 8 <= n; i += 8)
+	count += __builtin_popcountll(load(a + i) ^ load(b + i));
+      return count + hamming_portable(a + i, b + i, n - i);
+    }
+
+    /************************************************************************/
+    /* SSE2                                                                 */
+    /************************************************************************/
+    template<unsigned op>
+    __attribute__((target("sse2")))
+    static void			binary_sse2(unsigned char* r, const unsigned char* a, const size_t n)
+    {
+      size_t			i = 0;
+
+      for (; i + 16 <= n; i += 16)
+	{
+	  const __m128i		x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+	  const __m128i		y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+
+	  _mm_storeu_si128(reinterpret_cast<__m128i*>(r + i),
+			   op == AND ? _mm_and_si128(x, y) : op == OR ? _mm_or_si128(x, y)
+			   : op == XOR ? _mm_xor_si128(x, y) : _mm_andnot_si128(y, x));
+	}
+      binary_portable<op>(r + i, a + i, n - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void			not_sse2(unsigned char* r, const size_t n)
+    {
+      const __m128i		ones = _mm_set1_epi32(-1);
+      size_t			i = 0;
+
+      for (; i + 16 <= n; i += 16)
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(r + i),
+			 _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i)), ones));
+      not_portable(r + i, n - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void			fill_sse2(unsigned char* r, const size_t n, const uint64_t pattern)
+    {
+      const __m128i		v = _mm_set1_epi64x(static_cast<long long>(pattern));
+      size_t			i = 0;
+
+      for (; i + 16 <= n; i += 16)
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(r + i), v);
+      fill_portable(r + i, n - i, pattern);
+    }
+
+    __attribute__((target("sse2")))
+    static void			lshift_sse2(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			top = n;
+
+      for (; top >= bytes + 24; top -= 16)
+	{
+	  const __m128i		x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + top - 16 - bytes));
+	  const __m128i		y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + top - 24 - bytes));
+
+	  _mm_storeu_si128(reinterpret_cast<__m128i*>(r + top - 16), _mm_or_si128(_mm_sll_epi64(x, cnt), _mm_srl_epi64(y, sub_cnt)));
+	}
+      lshift_from(r, n, top, bytes, bits);
+    }
+
+    __attribute__((target("sse2")))
+    static void			rshift_sse2(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			bottom = 0;
+
+      for (; bottom + bytes + 24 <= n; bottom += 16)
+	{
+	  const __m128i		x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + bottom + bytes));
+	  const __m128i		y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + bottom + bytes + 8));
+
+	  _mm_storeu_si128(reinterpret_cast<__m128i*>(r + bottom), _mm_or_si128(_mm_srl_epi64(x, cnt), _mm_sll_epi64(y, sub_cnt)));
+	}
+      rshift_from(r, n, bottom, bytes, bits);
+    }
+
+    /************************************************************************/
+    /* AVX2                                                                 */
+    /************************************************************************/
+    template<unsigned op>
+    __attribute__((target("avx2")))
+    static void			binary_avx2(unsigned char* r, const unsigned char* a, const size_t n)
+    {
+      size_t			i = 0;
+
+      for (; i + 32 <= n; i += 32)
+	{
+	  const __m256i		x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i));
+	  const __m256i		y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+
+	  _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i),
+			      op == AND ? _mm256_and_si256(x, y) : op == OR ? _mm256_or_si256(x, y)
+			      : op == XOR ? _mm256_xor_si256(x, y) : _mm256_andnot_si256(y, x));
+	}
+      binary_portable<op>(r + i, a + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void			not_avx2(unsigned char* r, const size_t n)
+    {
+      const __m256i		ones = _mm256_set1_epi32(-1);
+      size_t			i = 0;
+
+      for (; i + 32 <= n; i += 32)
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i),
+			    _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i)), ones));
+      not_portable(r + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void			fill_avx2(unsigned char* r, const size_t n, const uint64_t pattern)
+    {
+      const __m256i		v = _mm256_set1_epi64x(static_cast<long long>(pattern));
+      size_t			i = 0;
+
+      for (; i + 32 <= n; i += 32)
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), v);
+      fill_portable(r + i, n - i, pattern);
+    }
+
+    __attribute__((target("avx2")))
+    static void			lshift_avx2(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			top = n;
+
+      for (; top >= bytes + 40; top -= 32)
+	{
+	  const __m256i		x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + top - 32 - bytes));
+	  const __m256i		y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + top - 40 - bytes));
+
+	  _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + top - 32),
+			      _mm256_or_si256(_mm256_sll_epi64(x, cnt), _mm256_srl_epi64(y, sub_cnt)));
+	}
+      lshift_from(r, n, top, bytes, bits);
+    }
+
+    __attribute__((target("avx2")))
+    static void			rshift_avx2(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			bottom = 0;
+
+      for (; bottom + bytes + 40 <= n; bottom += 32)
+	{
+	  const __m256i		x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + bottom + bytes));
+	  const __m256i		y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + bottom + bytes + 8));
+
+	  _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + bottom),
+			      _mm256_or_si256(_mm256_srl_epi64(x, cnt), _mm256_sll_epi64(y, sub_cnt)));
+	}
+      rshift_from(r, n, bottom, bytes, bits);
+    }
+
+    /**
+     ** \brief
+     ** Adds the bits set in each byte of `v` to the 64 bits lanes of `count`
+     ** Each nibble is looked up in a table of its bit counts, the bytes being summed by lane
+     */
+    __attribute__((target("avx2")))
+    static __m256i		add_popcount_avx2(const __m256i v, const __m256i count)
+    {
+      const __m256i		table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+							 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+      const __m256i		low = _mm256_set1_epi8(0x0F);
+      const __m256i		bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+							_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+
+      return _mm256_add_epi64(count, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+
+    __attribute__((target("avx2")))
+    static size_t		sum_avx2(const __m256i count)
+    {
+      return static_cast<size_t>(_mm256_extract_epi64(count, 0) + _mm256_extract_epi64(count, 1)
+				 + _mm256_extract_epi64(count, 2) + _mm256_extract_epi64(count, 3));
+    }
+
+    __attribute__((target("avx2")))
+    static size_t		popcount_avx2(const unsigned char* a, const size_t n)
+    {
+      __m256i			count = _mm256_setzero_si256();
+      size_t			i = 0;
+
+      for (; i + 32 <= n; i += 32)
+	count = add_popcount_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), count);
+      return sum_avx2(count) + popcount_portable(a + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static size_t		hamming_avx2(const unsigned char* a, const unsigned char* b, const size_t n)
+    {
+      __m256i			count = _mm256_setzero_si256();
+      size_t			i = 0;
+
+      for (; i + 32 <= n; i += 32)
+	count = add_popcount_avx2(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+					       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))), count);
+      return sum_avx2(count) + hamming_portable(a + i, b + i, n - i);
+    }
+
+    /************************************************************************/
+    /* AVX-512                                                              */
+    /************************************************************************/
+    // Unmasked andnot and shifts start from an undefined vector, which some compilers warn about: full masks are used instead
+    template<unsigned op>
+    __attribute__((target("avx512f")))
+    static void			binary_avx512(unsigned char* r, const unsigned char* a, const size_t n)
+    {
+      size_t			i = 0;
+
+      for (; i + 64 <= n; i += 64)
+	{
+	  const __m512i		x = _mm512_loadu_si512(r + i);
+	  const __m512i		y = _mm512_loadu_si512(a + i);
+
+	  _mm512_storeu_si512(r + i,
+			      op == AND ? _mm512_and_si512(x, y) : op == OR ? _mm512_or_si512(x, y)
+			      : op == XOR ? _mm512_xor_si512(x, y) : _mm512_mask_andnot_epi64(x, 0xFF, y, x));
+	}
+      binary_portable<op>(r + i, a + i, n - i);
+    }
+
+    __attribute__((target("avx512f")))
+    static void			not_avx512(unsigned char* r, const size_t n)
+    {
+      const __m512i		ones = _mm512_set1_epi32(-1);
+      size_t			i = 0;
+
+      for (; i + 64 <= n; i += 64)
+	_mm512_storeu_si512(r + i, _mm512_xor_si512(_mm512_loadu_si512(r + i), ones));
+      not_portable(r + i, n - i);
+    }
+
+    __attribute__((target("avx512f")))
+    static void			fill_avx512(unsigned char* r, const size_t n, const uint64_t pattern)
+    {
+      const __m512i		v = _mm512_set1_epi64(static_cast<long long>(pattern));
+      size_t			i = 0;
+
+      for (; i + 64 <= n; i += 64)
+	_mm512_storeu_si512(r + i, v);
+      fill_portable(r + i, n - i, pattern);
+    }
+
+    __attribute__((target("avx512f")))
+    static void			lshift_avx512(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			top = n;
+
+      for (; top >= bytes + 72; top -= 64)
+	{
+	  const __m512i		x = _mm512_loadu_si512(r + top - 64 - bytes);
+	  const __m512i		y = _mm512_loadu_si512(r + top - 72 - bytes);
+
+	  _mm512_storeu_si512(r + top - 64, _mm512_or_si512(_mm512_mask_sll_epi64(x, 0xFF, x, cnt), _mm512_mask_srl_epi64(y, 0xFF, y, sub_cnt)));
+	}
+      lshift_from(r, n, top, bytes, bits);
+    }
+
+    __attribute__((target("avx512f")))
+    static void			rshift_avx512(unsigned char* r, const size_t n, const size_t bytes, const unsigned bits)
+    {
+      const __m128i		cnt = _mm_cvtsi32_si128(static_cast<int>(bits));
+      const __m128i		sub_cnt = _mm_cvtsi32_si128(static_cast<int>(64 - bits));
+      size_t			bottom = 0;
+
+      for (; bottom + bytes + 72 <= n; bottom += 64)
+	{
+	  const __m512i		x = _mm512_loadu_si512(r + bottom + bytes);
+	  const __m512i		y = _mm512_loadu_si512(r + bottom + bytes + 8);
+
+	  _mm512_storeu_si512(r + bottom, _mm512_or_si512(_mm512_mask_srl_epi64(x, 0xFF, x, cnt), _mm512_mask_sll_epi64(y, 0xFF, y, sub_cnt)));
+	}
+      rshift_from(r, n, bottom, bytes, bits);
+    }
+
+    // Lanes are summed through memory, the reductions of some compilers tripping their uninitialized warnings
+    __attribute__((target("avx512f")))
+    static size_t		sum_avx512(const __m512i count)
+    {
+      uint64_t			lanes[8];
+      size_t			sum = 0;
+
+      _mm512_storeu_si512(lanes, count);
+      for (unsigned i = 0; i < 8; ++i)
+	sum += lanes[i];
+      return sum;
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    static size_t		popcount_avx512(const unsigned char* a, const size_t n)
+    {
+      __m512i			count = _mm512_setzero_si512();
+      size_t			i = 0;
+
+      for (; i + 64 <= n; i += 64)
+	count = _mm512_add_epi64(count, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+      return sum_avx512(count) + popcount_portable(a + i, n - i);
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    static size_t		hamming_avx512(const unsigned char* a, const unsigned char* b, const size_t n)
+    {
+      __m512i			count = _mm512_setzero_si512();
+      size_t			i = 0;
+
+      for (; i + 64 <= n; i += 64)
+	count = _mm512_add_epi64(count, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a + i),
+									      _mm512_loadu_si512(b + i))));
+      return sum_avx512(count) + hamming_portable(a + i, b + i, n - i);
+    }
+#endif
+  };
+
+  /**
+   ** \brief
+   ** Bitwise operations on raw arrays of words, least significant word first, run by mabit_simd_bytes
+   ** Results are written over the first operand, which may also be the second one
+   */
+  template<typename word_t>
+  struct mabit_simd
+  {
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+
+    static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
+
+    static_assert(sizeof(word_t) <= sizeof(uint64_t), "Mabit: words are expected to fit 64 bits lanes");
+
+    static void		and_n(word_p r, word_cp a, const msize_t n)
+    {
+      mabit_simd_bytes::binary<mabit_simd_bytes::AND>(bytes(r), bytes(a), n * sizeof(word_t));
+    }
+
+    static void		or_n(word_p r, word_cp a, const msize_t n)
+    {
+      mabit_simd_bytes::binary<mabit_simd_bytes::OR>(bytes(r), bytes(a), n * sizeof(word_t));
+    }
+
+    static void		xor_n(word_p r, word_cp a, const msize_t n)
+    {
+      mabit_simd_bytes::binary<mabit_simd_bytes::XOR>(bytes(r), bytes(a), n * sizeof(word_t));
+    }
+
+    // r[0, n) &= ~a[0, n)
+    static void		andnot_n(word_p r, word_cp a, const msize_t n)
+    {
+      mabit_simd_bytes::binary<mabit_simd_bytes::ANDNOT>(bytes(r), bytes(a), n * sizeof(word_t));
+    }
+
+    static void		not_n(word_p r, const msize_t n)
+    {
+      mabit_simd_bytes::bit_not(bytes(r), n * sizeof(word_t));
+    }
+
+    static void		fill_n(word_p r, const msize_t n, const word_t w)
+    {
+      uint64_t		pattern;
+
+      for (size_t i = 0; i < sizeof(pattern); i += sizeof(word_t))
+	std::memcpy(reinterpret_cast<unsigned char*>(&pattern) + i, &w, sizeof(word_t));
+      mabit_simd_bytes::fill(bytes(r), n * sizeof(word_t), pattern);
+    }
+
+    static msize_t	popcount(word_cp a, const msize_t n)
+    {
+      return mabit_simd_bytes::popcount(bytes(a), n * sizeof(word_t));
+    }
+
+    static msize_t	hamming(word_cp a, word_cp b, const msize_t n)
+    {
+      return mabit_simd_bytes::hamming(bytes(a), bytes(b), n * sizeof(word_t));
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) <<= shift, with 0 < shift < n * BITS_IN_WORD
+     */
+    static void		lshift(word_p r, const msize_t n, const msize_t shift)
+    {
+#ifdef MABIT_SIMD_LITTLE_ENDIAN
+      mabit_simd_bytes::lshift(bytes(r), n * sizeof(word_t), shift);
+#else
+      const msize_t	block = shift / BITS_IN_WORD;
+      const unsigned	offset = shift % BITS_IN_WORD;
+
+      for (msize_t i = n; i-- > block; )
+	{
+	  const word_t	low = i > block ? r[i - block - 1] : 0;
+
+	  r[i] = offset ? static_cast<word_t>(r[i - block] << offset) | (low >> (BITS_IN_WORD - offset)) : r[i - block];
+	}
+      std::fill(r, r + block, 0);
+#endif
+    }
+
+    /**
+     ** \brief
+     ** r[0, n) >>= shift, with 0 < shift < n * BITS_IN_WORD
+     */
+    static void		rshift(word_p r, const msize_t n, const msize_t shift)
+    {
+#ifdef MABIT_SIMD_LITTLE_ENDIAN
+      mabit_simd_bytes::rshift(bytes(r), n * sizeof(word_t), shift);
+#else
+      const msize_t	block = shift / BITS_IN_WORD;
+      const unsigned	offset = shift % BITS_IN_WORD;
+
+      for (msize_t i = 0; i + block < n; ++i)
+	{
+	  const word_t	high = i + block + 1 < n ? r[i + block + 1] : 0;
+
+	  r[i] = offset ? (r[i + block] >> offset) | static_cast<word_t>(high << (BITS_IN_WORD - offset)) : r[i + block];
+	}
+      std::fill(r + n - block, r + n, 0);
+#endif
+    }
+
+  private:
+    static unsigned char*	bytes(word_p p)
+    {
+      return reinterpret_cast<unsigned char*>(p);
+    }
+
+    static const unsigned char*	bytes(word_cp p)
+    {
+      return reinterpret_cast<const unsigned char*>(p);
+    }
+  };
+}
+
+#endif // !MABIT_SIMD_HPP
@@ -0,0 +1,257 @@
+#ifndef MABIT_STORAGE_HPP
+#define MABIT_STORAGE_HPP
+
+#include <algorithm>					// std::copy, std::fill
+#include <memory>					// std::allocator
+#include "mabit_traits.hpp"
+
+// Bits held inside the object itself, bigger values being moved to the heap
+#ifndef MABIT_INLINE_BITS
+# define MABIT_INLINE_BITS		256
+#endif
+
+namespace Mabit
+{
+  /**
+   ** \brief
+   ** Vector of words keeping the first INLINE_WORDS of them inside the object
+   ** Values that fit never reach the allocator, bigger ones spill to the heap
+   ** Only the part of the std::vector interface used by mabitset is provided
+   ** Heap words come from `alloc_t`, which is expected to be stateless like std::allocator
+   */
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabit_storage
+  {
+  public:
+    typedef typename mabit_traits<word_t>::msize_t	msize_t;
+    typedef typename mabit_traits<word_t>::word_p	word_p;
+    typedef typename mabit_traits<word_t>::word_cp	word_cp;
+    typedef typename mabit_traits<word_t>::r_word_p	r_word_p;
+    typedef typename mabit_traits<word_t>::r_word_cp	r_word_cp;
+
+    typedef word_t					value_type;
+    typedef word_p					iterator;
+    typedef word_cp					const_iterator;
+    typedef alloc_t					allocator_type;
+    typedef mabit_storage<word_t, alloc_t>		mabit_storage_t;
+
+    static const msize_t				INLINE_WORDS = MABIT_INLINE_BITS / 8 / sizeof(word_t) ? MABIT_INLINE_BITS / 8 / sizeof(word_t) : 1;
+
+    mabit_storage() : _data(_inline), _size(0), _capacity(INLINE_WORDS)
+    {
+    }
+
+    mabit_storage(const mabit_storage_t& other) : _data(_inline), _size(0), _capacity(INLINE_WORDS)
+    {
+      assign(other.begin(), other.end());
+    }
+
+    mabit_storage(mabit_storage_t&& other) : _data(_inline), _size(0), _capacity(INLINE_WORDS)
+    {
+      steal(other);
+    }
+
+    ~mabit_storage()
+    {
+      release();
+    }
+
+    mabit_storage_t&	operator = (const mabit_storage_t& other)
+    {
+      if (this != &other)
+	assign(other.begin(), other.end());
+      return *this;
+    }
+
+    mabit_storage_t&	operator = (mabit_storage_t&& other)
+    {
+      if (this != &other)
+	{
+	  release();
+	  _data = _inline;
+	  _size = 0;
+	  _capacity = INLINE_WORDS;
+	  steal(other);
+	}
+      return *this;
+    }
+
+    word_t&		operator [] (const msize_t at)
+    {
+      return _data[at];
+    }
+
+    const word_t&	operator [] (const msize_t at) const
+    {
+      return _data[at];
+    }
+
+    msize_t		size() const
+    {
+      return _size;
+    }
+
+    msize_t		capacity() const
+    {
+      return _capacity;
+    }
+
+    bool		empty() const
+    {
+      return !_size;
+    }
+
+    word_p		data()
+    {
+      return _data;
+    }
+
+    word_cp		data() const
+    {
+      return _data;
+    }
+
+    iterator		begin()
+    {
+      return _data;
+    }
+
+    const_iterator	begin() const
+    {
+      return _data;
+    }
+
+    iterator		end()
+    {
+      return _data + _size;
+    }
+
+    const_iterator	end() const
+    {
+      return _data + _size;
+    }
+
+    r_word_p		rbegin()
+    {
+      return r_word_p(end());
+    }
+
+    r_word_cp		rbegin() const
+    {
+      return r_word_cp(end());
+    }
+
+    r_word_p		rend()
+    {
+      return r_word_p(begin());
+    }
+
+    r_word_cp		rend() const
+    {
+      return r_word_cp(begin());
+    }
+
+    word_t&		back()
+    {
+      return _data[_size - 1];
+    }
+
+    const word_t&	back() const
+    {
+      return _data[_size - 1];
+    }
+
+    /**
+     ** \brief
+     ** Makes room for `n` words, the capacity at least doubles so that push_back() stays amortized
+     */
+    void		reserve(const msize_t n)
+    {
+      if (n <= _capacity)
+	return ;
+
+      const msize_t	capacity = n < 2 * _capacity ? 2 * _capacity : n;
+      const word_p	data = alloc_t().allocate(capacity);
+
+      std::copy(_data, _data + _size, data);
+      release();
+      _data = data;
+      _capacity = capacity;
+    }
+
+    void		resize(const msize_t n, const word_t val = 0)
+    {
+      reserve(n);
+      if (n > _size)
+	std::fill(_data + _size, _data + n, val);
+      _size = n;
+    }
+
+    void		push_back(const word_t w)
+    {
+      if (_size == _capacity)
+	reserve(_size + 1);
+      _data[_size++] = w;
+    }
+
+    void		pop_back()
+    {
+      --_size;
+    }
+
+    void		clear()
+    {
+      _size = 0;
+    }
+
+    template<typename Iterator>
+    void		assign(Iterator first, Iterator last)
+    {
+      const msize_t	n = static_cast<msize_t>(last - first);
+
+      _size = 0;
+      reserve(n);
+      std::copy(first, last, _data);
+      _size = n;
+    }
+
+  private:
+    word_p		_data;
+    msize_t		_size;
+    msize_t		_capacity;
+    word_t		_inline[INLINE_WORDS];
+
+    bool		on_heap() const
+    {
+      return _data != _inline;
+    }
+
+    void		release()
+    {
+      if (on_heap())
+	alloc_t().deallocate(_data, _capacity);
+    }
+
+    /**
+     ** \brief
+     ** Takes the words of `other`, which is left empty
+     ** Heap buffers change hands, inline words get copied
+     */
+    void		steal(mabit_storage_t& other)
+    {
+      if (other.on_heap())
+	{
+	  _data = other._data;
+	  _capacity = other._capacity;
+	  other._data = other._inline;
+	  other._capacity = INLINE_WORDS;
+	}
+      else
+	std::copy(other._data, other._data + other._size, _data);
+      _size = other._size;
+      other._size = 0;
+    }
+  };
+}
+
+#endif // !MABIT_STORAGE_HPP
@@ -4,12 +4,22 @@
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <utility>
 #include <algorithm>
 #include "mabit_traits.hpp"
 #include "mabit.hpp"
+#include "mabit_kernel.hpp"
+
+#ifndef MABIT_DC_TO_BASE_THRESHOLD
+# define MABIT_DC_TO_BASE_THRESHOLD	30
+#endif
+
+#ifndef MABIT_DC_FROM_BASE_THRESHOLD
+# define MABIT_DC_FROM_BASE_THRESHOLD	30
+#endif
 
 namespace Mabit
 {
@@ -21,12 +31,20 @@ namespace Mabit
       HEX = 16
     };
 
-  template<typename word_t>
+  template<typename word_t, typename alloc_t>
   class	mabit_stream
   {
   public:
     typedef typename mabit_traits<word_t>::msize_t	msize_t;
-    typedef mabit<word_t>				mabit_t;
+    typedef mabit<word_t, alloc_t>			mabit_t;
+    typedef mabit_kernel<word_t, alloc_t>		kernel_t;
+    typedef std::vector<word_t, alloc_t>		words_t;
+
+    // Size (in words) under which conversions to and from a base take the schoolbook path
+    static const msize_t				DC_TO_BASE_THRESHOLD = MABIT_DC_TO_BASE_THRESHOLD;
+    static const msize_t				DC_FROM_BASE_THRESHOLD = MABIT_DC_FROM_BASE_THRESHOLD;
+
+    static_assert(DC_FROM_BASE_THRESHOLD >= 1, "Mabit: conversion from a base threshold should be >= 1");
 
     static std::string	to_string(const mabit_t& nb, const base_t base, const char sep = 0)
     {
@@ -44,56 +62,81 @@ namespace Mabit
       return to_bin(nb, sep);
     }
 
-  private:
-    static std::string	to_bin(const mabit_t& nb, const char sep)
+    /**
+     ** \brief
+     ** Reads `src` written in `base` (2 to 36, digits of either case) into `nb`, with an optional leading '-'
+     ** Throws std::invalid_argument, `nb` being left untouched, for a base out of [2, 36] or a character which is not one of its digits
+     */
+    static void		from_string(mabit_t& nb, const std::string& src, const int base)
     {
-      std::string	ret;
-
-      if (!nb._sign)
-	ret += '-';
+      const bool	negative = !src.empty() && src[0] == '-';
+      std::vector<char>	digits;
+      words_t		words;
 
-      msize_t		words = nb.used_words();
+      if (base < 2 || base > 36)
+	throw std::invalid_argument("Mabit: the base should be between 2 and 36");
 
-      if (!words)
+      digits.reserve(src.size());
+      for (size_t i = negative ? 1 : 0; i < src.size(); ++i)
 	{
-	  for (msize_t i = 0; i < nb._set.BITS_IN_WORD; ++i)
-	    ret += '0';
-	  return ret;
+	  const int	digit = digit_value(src[i]);
+
+	  if (digit >= base)
+	    throw std::invalid_argument("Mabit: the string should only hold digits of its base");
+	  digits.push_back(static_cast<char>(digit));
 	}
 
-      bool		first = true;
-      word_t		simulated_abs;
+      if (!(base & (base - 1)))
+	pow2_to_bin(digits, base, words);
+      else
+	base_to_bin(digits, base, words);
 
-      for (; words > 0; --words)
-	{
-	  simulated_abs = nb.simulate_abs(words - 1);
+      nb._sign = true;
+      nb._set.assign(words.begin(), words.end());
+      nb.normalize(nb._set.size());
+      if (nb._set.size() < mabit_t::MIN_SIZE)
+	nb.resize(mabit_t::MIN_SIZE);
 
-	  if (first && !simulated_abs)
-	    {
-	      first = false;
-	      continue ;
-	    }
+      if (negative)
+	nb.negate();
+    }
 
-	  for (msize_t offset = 0; offset < nb._set.BITS_IN_WORD; ++offset)
-	    ret += !nb.get_bit(simulated_abs, nb._set.BITS_IN_WORD - 1 - offset) ? '0' : '1';
+  private:
+    /**
+     ** \brief
+     ** Prints every word of the absolute value in binary, most significant first
+     */
+    static std::string	to_bin(const mabit_t& nb, const char sep)
+    {
+      const msize_t	bits = nb._set.BITS_IN_WORD;
+      const msize_t	words = nb.used_words();
 
-	  if (sep && words > 1)
-	    ret += sep;
+      if (!words)
+	return std::string(bits, '0');
+
+      std::string	ret(words * bits + (sep ? words - 1 : 0) + !nb._sign, sep);
+      size_t		pos = 0;
+
+      if (!nb._sign)
+	ret[pos++] = '-';
+
+      for (msize_t i = words; i > 0; --i)
+	{
+	  const word_t	w = nb._set[i - 1];
+
+	  for (msize_t offset = bits; offset > 0; --offset)
+	    ret[pos++] = '0' + ((w >> (offset - 1)) & 1);
 
-	  first = false;
+	  // Separators are already in place
+	  if (sep)
+	    ++pos;
 	}
       return ret;
     }
-    
+
     static std::string	to_oct(const mabit_t& nb, const char sep)
     {
-      std::vector<char>	tmp;
-      std::string	ret;
-
-      bin_to_base(nb, OCT, tmp);
-      build_str(ret, tmp, sep, nb._sign, 2, OCT);
-
-      return ret;
+      return to_pow2(nb, 3, sep, 2);
     }
 
     static std::string	to_dec(const mabit_t& nb, const char sep)
@@ -109,32 +152,300 @@ namespace Mabit
 
     static std::string	to_hex(const mabit_t& nb, const char sep)
     {
-      std::vector<char>	tmp;
-      std::string	ret;
+      return to_pow2(nb, 4, sep, 2);
+    }
+
+    /**
+     ** \brief
+     ** Prints the absolute value in base 2^shift by slicing its words, every digit being a group of bits
+     ** Digits are grouped by `delimit_pos` from the least significant one, like build_str() does
+     */
+    static std::string	to_pow2(const mabit_t& nb, const unsigned shift, const char sep, const size_t delimit_pos)
+    {
+      static const char	digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+      const msize_t	bits = nb._set.BITS_IN_WORD;
+      const msize_t	words = nb.used_words();
+
+      if (!words)
+	return std::string(1, '0');
 
-      bin_to_base(nb, HEX, tmp);
-      build_str(ret, tmp, sep, nb._sign, 2, HEX);
+      const msize_t	used_bits = nb.used_bits();
+      const size_t	count = (used_bits + shift - 1) / shift;
+      const word_t	mask = static_cast<word_t>((1U << shift) - 1);
+      std::string	ret(count + (sep ? (count - 1) / delimit_pos : 0) + !nb._sign, sep);
+      size_t		pos = ret.size();
+
+      if (!nb._sign)
+	ret[0] = '-';
+
+      // Fills the string from its end, least significant digit first
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const msize_t	bit = i * shift;
+	  const msize_t	at = bit / bits;
+	  const unsigned	offset = bit % bits;
+	  word_t	digit = nb._set[at] >> offset;
 
+	  if (offset + shift > bits && at + 1 < words)
+	    digit |= static_cast<word_t>(nb._set[at + 1] << (bits - offset));
+
+	  if (sep && i && !(i % delimit_pos))
+	    --pos;
+	  ret[--pos] = digits[digit & mask];
+	}
       return ret;
     }
 
+    /**
+     ** \brief
+     ** Stores the digits of the absolute value of `data` in `base` inside `ret`, least significant first
+     ** Big numbers are split by powers of the base (divide and conquer), small ones
+     ** get one word worth of digits out of each division
+     */
     static void		bin_to_base(const mabit_t& data, const base_t base, std::vector<char>& ret)
     {
-      word_t		abs;
+      const msize_t	n = data.used_words();
+
+      if (!n)
+	{
+	  ret.push_back(0);
+	  return ;
+	}
+
+      // The words hold the magnitude, whatever the sign
+      words_t		a(data._set.data(), data._set.data() + n);
+
+      // powers[i] = radix_power^(2^i), the biggest one being about half the size of the number
+      std::vector<words_t>	powers(1, words_t(1, kernel_t::radix_power(base)));
+
+      while (4 * powers.back().size() <= a.size() + 1)
+	{
+	  const words_t&	last = powers.back();
+	  words_t		square(2 * last.size());
+
+	  kernel_t::sqr(square.data(), last.data(), last.size());
+	  square.resize(kernel_t::normalize(square.data(), square.size()));
+	  powers.push_back(std::move(square));
+	}
 
-      ret.push_back(0);
+      to_base(ret, a.data(), a.size(), base, powers, powers.size() - 1, 0);
+
+      // Only the low parts are padded, the top one may still end with zeros
+      while (ret.size() > 1 && !ret.back())
+	ret.pop_back();
+    }
+
+    /**
+     ** \brief
+     ** Appends the digits of a[0, n) to `ret`, padded with zeros up to `digits` when it is not 0
+     ** `a` is destroyed, powers[0, level] are the powers of the base it can be split by
+     */
+    static void		to_base
+    (
+     std::vector<char>& ret,
+     word_t* a,
+     msize_t n,
+     const base_t base,
+     const std::vector<words_t>& powers,
+     size_t level,
+     const size_t digits
+     )
+    {
+      n = kernel_t::normalize(a, n);
 
-      for (msize_t i = data.used_words(); i > 0; --i)
+      if (n < DC_TO_BASE_THRESHOLD)
 	{
-	  abs = data.simulate_abs(i - 1);
+	  to_base_basecase(ret, a, n, base, digits);
+	  return ;
+	}
+
+      // Splits around the biggest power no longer than half of the number
+      while (level > 0 && 2 * powers[level].size() > n + 1)
+	--level;
+
+      const words_t&	power = powers[level];
+      const size_t	low_digits = static_cast<size_t>(kernel_t::radix_digits(base)) << level;
+      words_t		q(n - power.size() + 1);
+      words_t		r(power.size());
+
+      kernel_t::divrem(q.data(), r.data(), a, n, power.data(), power.size());
+
+      to_base(ret, r.data(), r.size(), base, powers, level, low_digits);
+      to_base(ret, q.data(), q.size(), base, powers, level, digits ? digits - low_digits : 0);
+    }
+
+    /**
+     ** \brief
+     ** Schoolbook conversion, every division by radix_power() gives radix_digits() digits
+     */
+    static void		to_base_basecase(std::vector<char>& ret, word_t* a, msize_t n, const base_t base, const size_t digits)
+    {
+      const unsigned	chunk = kernel_t::radix_digits(base);
+      const word_t	power = kernel_t::radix_power(base);
+      size_t		emitted = 0;
 
-	  for (msize_t j = 0; j < data._set.BITS_IN_WORD; ++j)
+      for (; n > 0; n = kernel_t::normalize(a, n))
+	{
+	  word_t	r = kernel_t::divrem_1(a, a, n, power);
+
+	  for (unsigned i = 0; i < chunk; ++i, r /= base)
+	    ret.push_back(static_cast<char>(r % base));
+	  emitted += chunk;
+	}
+
+      for (; emitted < digits; ++emitted)
+	ret.push_back(0);
+    }
+
+    /**
+     ** \brief
+     ** Returns the value of the digit `c`, 36 for a character which is a digit in no base
+     */
+    static int		digit_value(const char c)
+    {
+      if (c >= '0' && c <= '9')
+	return c - '0';
+      if (c >= 'a' && c <= 'z')
+	return c - 'a' + 10;
+      if (c >= 'A' && c <= 'Z')
+	return c - 'A' + 10;
+      return 36;
+    }
+
+    /**
+     ** \brief
+     ** Stores the number made of `digits` (most significant first) in the power of two `base` inside `ret`
+     ** Every digit is a group of bits written straight into its words
+     */
+    static void		pow2_to_bin(const std::vector<char>& digits, const int base, words_t& ret)
+    {
+      const msize_t	bits = sizeof(word_t) * 8;
+      const unsigned	shift = kernel_t::clz(1) - kernel_t::clz(static_cast<word_t>(base));
+      const size_t	count = digits.size();
+
+      ret.assign((count * shift + bits - 1) / bits, 0);
+
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const word_t	digit = static_cast<word_t>(digits[count - 1 - i]);
+	  const msize_t	bit = i * shift;
+	  const msize_t	at = bit / bits;
+	  const unsigned	offset = bit % bits;
+
+	  ret[at] |= static_cast<word_t>(digit << offset);
+	  if (offset + shift > bits)
+	    ret[at + 1] |= digit >> (bits - offset);
+	}
+    }
+
+    /**
+     ** \brief
+     ** Stores the number made of `digits` (most significant first) in `base` inside `ret`
+     ** Digits are first packed by radix_digits() into words, which are then merged by groups
+     ** of DC_FROM_BASE_THRESHOLD (schoolbook) and finally pairwise with cached powers of the base
+     */
+    static void		base_to_bin(const std::vector<char>& digits, const int base, words_t& ret)
+    {
+      const unsigned	chunk = kernel_t::radix_digits(base);
+      const word_t	power = kernel_t::radix_power(base);
+      const size_t	count = (digits.size() + chunk - 1) / chunk;
+      words_t		chunks(count);
+
+      // Least significant chunk first, the top one may hold less digits
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const size_t	end = digits.size() - i * chunk;
+	  word_t	value = 0;
+
+	  for (size_t j = end > chunk ? end - chunk : 0; j < end; ++j)
+	    value = static_cast<word_t>(value * base + digits[j]);
+	  chunks[i] = value;
+	}
+
+      std::vector<words_t>	blocks;
+      words_t			block_power(1, 1);
+
+      for (size_t i = 0; i < count; i += DC_FROM_BASE_THRESHOLD)
+	blocks.push_back(chunks_to_bin(chunks.data() + i, std::min(count - i, static_cast<size_t>(DC_FROM_BASE_THRESHOLD)), power));
+
+      // block_power = power^DC_FROM_BASE_THRESHOLD, the weight of a block
+      for (msize_t i = 0; i < DC_FROM_BASE_THRESHOLD && blocks.size() > 1; ++i)
+	{
+	  const word_t	carry = kernel_t::mul_1(block_power.data(), block_power.data(), block_power.size(), power);
+
+	  if (carry)
+	    block_power.push_back(carry);
+	}
+
+      // Product tree, each level merging the blocks two by two then squaring their weight
+      while (blocks.size() > 1)
+	{
+	  std::vector<words_t>	merged;
+
+	  for (size_t i = 0; i + 1 < blocks.size(); i += 2)
+	    merged.push_back(merge(blocks[i], blocks[i + 1], block_power));
+	  if (blocks.size() % 2)
+	    merged.push_back(std::move(blocks.back()));
+	  blocks = std::move(merged);
+
+	  if (blocks.size() > 1)
 	    {
-	      mult_by(ret, 2, base);
-	      if (data.get_bit(abs, data._set.BITS_IN_WORD - 1 - j))
-		add_one(ret, 0, base, 1);
+	      words_t		square(2 * block_power.size());
+
+	      kernel_t::sqr(square.data(), block_power.data(), block_power.size());
+	      square.resize(kernel_t::normalize(square.data(), square.size()));
+	      block_power = std::move(square);
 	    }
 	}
+
+      if (!blocks.empty())
+	ret = std::move(blocks[0]);
+    }
+
+    /**
+     ** \brief
+     ** Returns the number whose digits in base `power` are c[0, n), least significant first (Horner)
+     */
+    static words_t	chunks_to_bin(const word_t* c, const size_t n, const word_t power)
+    {
+      words_t		ret;
+
+      ret.reserve(n);
+      for (size_t i = n; i-- > 0;)
+	{
+	  word_t	carry = kernel_t::mul_1(ret.data(), ret.data(), ret.size(), power);
+
+	  if (carry)
+	    ret.push_back(carry);
+
+	  // Adding to an empty number carries the whole chunk out
+	  carry = kernel_t::add_1(ret.data(), ret.data(), ret.size(), c[i]);
+	  if (carry)
+	    ret.push_back(carry);
+	}
+      return ret;
+    }
+
+    /**
+     ** \brief
+     ** Returns lo + hi * weight, with lo < weight
+     */
+    static words_t	merge(const words_t& lo, const words_t& hi, const words_t& weight)
+    {
+      const msize_t	ln = kernel_t::normalize(lo.data(), lo.size());
+      const msize_t	hn = kernel_t::normalize(hi.data(), hi.size());
+
+      if (!hn)
+	return words_t(lo.begin(), lo.begin() + ln);
+
+      words_t		ret(hn + weight.size());
+
+      if (hn >= weight.size())
+	kernel_t::mul(ret.data(), hi.data(), hn, weight.data(), weight.size());
+      else
+	kernel_t::mul(ret.data(), weight.data(), weight.size(), hi.data(), hn);
+      kernel_t::add(ret.data(), ret.data(), ret.size(), lo.data(), ln);
+      return ret;
     }
 
     static void		build_str
@@ -161,45 +472,11 @@ namespace Mabit
 
       std::reverse(ret.begin(), ret.end());
     }
-
-    static void		add_one(std::vector<char>& nb, size_t i, const base_t base, int to_add = 1)
-    {
-      const char	limit = (static_cast<int>(base) - 1);
-
-      for (; i < nb.size(); ++i)
-	{
-	  if (nb[i] < limit)
-	    {
-	      nb[i] += 1;
-	      return ;
-	    }
-	  nb[i] = 0;
-	}
-      nb.push_back(1);
-    }
-
-    static void		mult_by(std::vector<char>& nb, unsigned int mult_by, const base_t base)
-    {
-      std::vector<char>	ret;
-      const size_t	size = nb.size();
-
-      for (size_t i = 0; i < size; ++i)
-	{
-	  unsigned int	add_how_much = nb[i] * mult_by;
-
-	  if (!add_how_much && i < size - 1)
-	    ret.push_back(0);
-
-	  for (; add_how_much > 0; --add_how_much)
-	    add_one(ret, i, base, add_how_much);
-	}
-      nb = std::move(ret);
-    }
   };
 }
 
-template<class Ch, class Tr, class word_t>
-std::basic_ostream<Ch, Tr>&	operator << (std::basic_ostream<Ch, Tr>& s, const Mabit::mabit<word_t>& obj)
+template<class Ch, class Tr, class word_t, class alloc_t>
+std::basic_ostream<Ch, Tr>&	operator << (std::basic_ostream<Ch, Tr>& s, const Mabit::mabit<word_t, alloc_t>& obj)
 {
   const char sep			= std::use_facet<std::numpunct<char> >(s.getloc()).thousands_sep();
   const std::ios_base::fmtflags	flags	= s.flags();
@@ -212,8 +489,16 @@ std::basic_ostream<Ch, Tr>&	operator << (std::basic_ostream<Ch, Tr>& s, const Ma
   else if (flags & std::ios_base::hex)
     base = Mabit::HEX;
 
-  s << Mabit::mabit_stream<word_t>::to_string(obj, base, sep);
+  s << Mabit::mabit_stream<word_t, alloc_t>::to_string(obj, base, sep);
   return s;
 }
 
+// Expressions are printed once evaluated
+template<class Ch, class Tr, class expr_t>
+typename std::enable_if<Mabit::is_mabit_expr<expr_t>::value, std::basic_ostream<Ch, Tr>&>::type
+				operator << (std::basic_ostream<Ch, Tr>& s, const expr_t& e)
+{
+  return s << typename expr_t::mabit_t(e);
+}
+
 #endif // !MABIT_STREAM_HPP
@@ -7,6 +7,25 @@ using std::reverse_iterator;
 
 namespace Mabit
 {
+  /**
+   ** \brief
+   ** Selects an unsigned integer at least twice as wide as `word_t`
+   ** Used to hold carries and partial products of two words
+   */
+  template<typename word_t, bool = (sizeof(word_t) < sizeof(unsigned long long))>
+  struct mabit_dword
+  {
+    typedef unsigned long long		type;
+  };
+
+#ifdef __SIZEOF_INT128__
+  template<typename word_t>
+  struct mabit_dword<word_t, false>
+  {
+    __extension__ typedef unsigned __int128	type;
+  };
+#endif
+
   template<typename word_t>
   struct mabit_traits
   {
@@ -18,6 +37,7 @@ namespace Mabit
     typedef reverse_iterator<word_p>	r_word_p;
     typedef reverse_iterator<word_cp>	r_word_cp;
     typedef size_t			msize_t;
+    typedef typename mabit_dword<word_t>::type	dword_t;
   };
 }
 
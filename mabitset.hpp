@@ -1,23 +1,24 @@
 #ifndef MABITSET_HPP
 #define MABITSET_HPP
 
-#include <algorithm>					// std::fill, std::for_each
+#include <algorithm>					// std::for_each
 #include <utility>					// std::forward
-#include <vector>
-#include "mabit_traits.hpp"
+#include "mabit_storage.hpp"
+#include "mabit_simd.hpp"
 
 namespace Mabit
 {
-  template<typename word_t>
-  class mabitset : public std::vector<word_t>
+  template<typename word_t, typename alloc_t = std::allocator<word_t> >
+  class mabitset : public mabit_storage<word_t, alloc_t>
   {
   public:
     typedef typename mabit_traits<word_t>::msize_t	msize_t;
     typedef typename mabit_traits<word_t>::word_r	word_r;
     typedef typename mabit_traits<word_t>::word_cr	word_cr;
 
-    typedef std::vector<word_t>				container_t;
-    typedef mabitset<word_t>				mabitset_t;
+    typedef mabit_storage<word_t, alloc_t>		container_t;
+    typedef mabitset<word_t, alloc_t>			mabitset_t;
+    typedef mabit_simd<word_t>				simd_t;
 
     static const msize_t				BITS_IN_WORD = sizeof(word_t) * 8;
 
@@ -47,23 +48,24 @@ namespace Mabit
       return *this;
     }
 
+    // Words beyond the ones of `other` are cleared
     mabitset_t&		operator &= (const mabitset_t& other)
     {
-      apply(*this, other, [] (word_r a, word_cr b) { a &= b; });
+      simd_t::and_n(this->data(), other.data(), common(other));
       sanitize(other.size());
       return *this;
     }
 
     mabitset_t&		operator |= (const mabitset_t& other)
     {
-      apply(*this, other, [] (word_r a, word_cr b) { a |= b; });
+      simd_t::or_n(this->data(), other.data(), common(other));
       sanitize(other.size());
       return *this;
     }
 
     mabitset_t&		operator ^= (const mabitset_t& other)
     {
-      apply(*this, other, [] (word_r a, word_cr b) { a ^= b; });
+      simd_t::xor_n(this->data(), other.data(), common(other));
       sanitize(other.size());
       return *this;
     }
@@ -79,21 +81,7 @@ namespace Mabit
 	  return *this;
 	}
 
-      const msize_t	block_shift = shift / BITS_IN_WORD;
-      const msize_t	offset = shift % BITS_IN_WORD;
-
-      if (!offset)
-	for (msize_t i = this->size() - 1; i >= block_shift; --i)
-	  (*this)[i] = (*this)[i - block_shift];
-      else
-	{
-	  const msize_t	sub_offset = BITS_IN_WORD - offset;
-
-	  for (msize_t i = this->size() - 1; i > block_shift; --i)
-	    (*this)[i] = ((*this)[i - block_shift] << offset) | ((*this)[i - block_shift - 1] >> sub_offset);
-	  (*this)[block_shift] = (*this)[0] << offset;
-	}
-      std::fill(this->begin(), this->begin() + block_shift, 0);
+      simd_t::lshift(this->data(), this->size(), shift);
       return *this;
     }
 
@@ -108,48 +96,24 @@ namespace Mabit
 	  return *this;
 	}
 
-      const msize_t	block_shift = shift / BITS_IN_WORD;
-      const msize_t	offset = shift % BITS_IN_WORD;
-      msize_t		limit = this->size() - block_shift;
-
-      if (limit)
-	--limit;
-
-      if (!offset)
-	for (msize_t i = 0; i <= limit; ++i)
-	  (*this)[i] = (*this)[i + block_shift];
-      else
-	{
-	  const msize_t	sub_offset = BITS_IN_WORD - offset;
-
-	  for (msize_t i = 0; i < limit; ++i)
-	    (*this)[i] = ((*this)[i + block_shift] >> offset) | ((*this)[i + block_shift + 1] << sub_offset);
-	  (*this)[limit] = (*this)[this->size() - 1] >> offset;
-	}
-      std::fill(this->begin() + limit + 1, this->end(), 0);
+      simd_t::rshift(this->data(), this->size(), shift);
       return *this;
     }
 
     void		flip()
     {
-      for (auto& w : *this)
-	w = ~w;
+      simd_t::not_n(this->data(), this->size());
     }
 
     void		fill(word_cr val)
     {
-      std::fill(this->begin(), this->end(), val);
+      simd_t::fill_n(this->data(), this->size(), val);
     }
 
   private:
-    template<typename Container, typename Function>
-    void		apply(Container& a, const Container& b, Function f)
+    msize_t		common(const mabitset_t& other) const
     {
-      auto		aItr = a.begin();
-      auto		bItr = b.begin();
-
-      for (; aItr != a.end() && bItr != b.end(); ++aItr, ++bItr)
-	f(*aItr, *bItr);
+      return this->size() < other.size() ? this->size() : other.size();
     }
 
     void		sanitize(const msize_t from)
@@ -0,0 +1,1031 @@
+/*
+** Checks the arithmetic of mabit for every word type against identities and plain reference implementations
+** Built by CMake with the default thresholds, and with the MABIT_*_THRESHOLD macros lowered so that the
+** subquadratic algorithms run on small operands
+** Another build turns the vector kernels off with MABIT_NO_SIMD
+** A C++20 build checks operator <=> as well
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mabit.hpp"
+#include "mabit_stream.hpp"
+#include "mabit_pool.hpp"
+#include "mabit_modulus.hpp"
+
+using namespace Mabit;
+
+namespace
+{
+  std::mt19937_64	rng(20261017);
+  int			failures = 0;
+
+  // Largest operands, in bits
+  const size_t		MAX_BITS = 3000;
+  const int		ITERATIONS = 60;
+
+#define CHECK(cond, what)						\
+  do									\
+    {									\
+      if (!(cond) && failures++ < 20)					\
+	std::printf("FAILED %s (word of %zu bits, line %d)\n", what, sizeof(word_t) * 8, __LINE__); \
+    }									\
+  while (0)
+
+  /************************************************************************/
+  /* OPERANDS                                                             */
+  /************************************************************************/
+  /**
+   ** \brief
+   ** Returns a random number of `bits` bits at most, with long runs of ones and zeros now and then
+   */
+  template<typename word_t>
+  mabit<word_t>		random(const size_t bits)
+  {
+    const size_t	word_bits = sizeof(word_t) * 8;
+    const size_t	n = (bits + word_bits - 1) / word_bits;
+    const int		kind = static_cast<int>(rng() % 6);
+    mabit<word_t>	ret;
+
+    ret.resize(n ? n : 1);
+    for (size_t i = 0; i < n; ++i)
+      ret[i] = static_cast<word_t>(kind == 0 ? ~0ULL : kind == 1 && i % 3 ? 0 : rng());
+    if (n && bits % word_bits)
+      ret[n - 1] = static_cast<word_t>(ret[n - 1] >> (word_bits - bits % word_bits));
+    if (rng() % 4 == 0)
+      ret.negate();
+    return ret;
+  }
+
+  template<typename word_t>
+  mabit<word_t>		random()
+  {
+    return random<word_t>(rng() % MAX_BITS);
+  }
+
+  /************************************************************************/
+  /* REFERENCES                                                           */
+  /************************************************************************/
+  /**
+   ** \brief
+   ** Schoolbook product, a word at a time
+   */
+  template<typename word_t>
+  mabit<word_t>		schoolbook(const mabit<word_t>& x, const mabit<word_t>& y)
+  {
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
+    const mabit<word_t>	a = x.abs();
+    const mabit<word_t>	b = y.abs();
+    const size_t	an = a.used_words();
+    const size_t	bn = b.used_words();
+    mabit<word_t>	ret;
+
+    ret.resize(an + bn + 1);
+    for (size_t i = 0; i < an; ++i)
+      {
+	dword_t		carry = 0;
+
+	for (size_t j = 0; j < bn; ++j)
+	  {
+	    const dword_t	t = static_cast<dword_t>(a[i]) * b[j] + ret[i + j] + carry;
+
+	    ret[i + j] = static_cast<word_t>(t);
+	    carry = t >> (sizeof(word_t) * 8);
+	  }
+	ret[i + bn] = static_cast<word_t>(carry);
+      }
+    if ((x < mabit<word_t>(0)) != (y < mabit<word_t>(0)))
+      ret.negate();
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** Sum of `x` and `y`, adding or subtracting the magnitudes a word at a time
+   */
+  template<typename word_t>
+  mabit<word_t>		wordwise_sum(const mabit<word_t>& x, const mabit<word_t>& y)
+  {
+    typedef typename mabit_traits<word_t>::dword_t	dword_t;
+    const bool		x_sign = !(x < mabit<word_t>(0));
+    const bool		y_sign = !(y < mabit<word_t>(0));
+    const bool		swap = x_sign != y_sign && x.abs() < y.abs();
+    const mabit<word_t>	a = swap ? y.abs() : x.abs();
+    const mabit<word_t>	b = swap ? x.abs() : y.abs();
+    const size_t	n = a.used_words() > b.used_words() ? a.used_words() : b.used_words();
+    const dword_t	base = static_cast<dword_t>(1) << (sizeof(word_t) * 8);
+    dword_t		carry = 0;
+    mabit<word_t>	ret;
+
+    ret.resize(n + 1);
+    for (size_t i = 0; i < n; ++i)
+      {
+	const dword_t	u = i < a.used_words() ? a[i] : 0;
+	const dword_t	v = (i < b.used_words() ? b[i] : 0) + carry;
+
+	// Carries when adding, borrows when subtracting the smallest magnitude
+	if (x_sign == y_sign)
+	  {
+	    ret[i] = static_cast<word_t>(u + v);
+	    carry = (u + v) >> (sizeof(word_t) * 8);
+	  }
+	else
+	  {
+	    ret[i] = static_cast<word_t>(u < v ? u + base - v : u - v);
+	    carry = u < v;
+	  }
+      }
+    ret[n] = static_cast<word_t>(carry);
+    if (swap ? !y_sign : !x_sign)
+      ret.negate();
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** Decimal digits of `a`, one division by 10 at a time
+   */
+  template<typename word_t>
+  std::string		decimal(const mabit<word_t>& a)
+  {
+    mabit<word_t>	x = a.abs();
+    std::string		ret;
+
+    while (x.any())
+      ret.insert(ret.begin(), static_cast<char>('0' + x.divmod(static_cast<word_t>(10), x)));
+    if (ret.empty())
+      return "0";
+    if (a < mabit<word_t>(0))
+      ret.insert(ret.begin(), '-');
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** Digits of the non-negative `a` in base 2^shift, read bit by bit, with a '.' between groups of `group` digits
+   */
+  template<typename word_t>
+  std::string		pow2_digits(const mabit<word_t>& a, const size_t shift, const size_t group)
+  {
+    static const char	digits[] = "0123456789ABCDEF";
+    const size_t	count = (a.used_bits() + shift - 1) / shift;
+    std::string		ret;
+
+    for (size_t i = 0; i < count; ++i)
+      {
+	size_t		digit = 0;
+
+	for (size_t j = 0; j < shift; ++j)
+	  digit |= static_cast<size_t>(a.get_bit(i * shift + j)) << j;
+	if (group && i && !(i % group))
+	  ret.insert(ret.begin(), '.');
+	ret.insert(ret.begin(), digits[digit]);
+      }
+    return ret.empty() ? "0" : ret;
+  }
+
+  /**
+   ** \brief
+   ** Two's complement of `a` on `n` words
+   */
+  template<typename word_t>
+  std::vector<word_t>	twos_complement(const mabit<word_t>& a, const size_t n)
+  {
+    const mabit<word_t>	m = a.abs();
+    const bool		negative = a < mabit<word_t>(0);
+    std::vector<word_t>	ret(n);
+    bool		carry = true;
+
+    for (size_t i = 0; i < n; ++i)
+      {
+	const word_t	w = i < m.used_words() ? m[i] : 0;
+
+	ret[i] = negative ? static_cast<word_t>(~w + carry) : w;
+	carry = carry && !w;
+      }
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** Value of the two's complement `words`, negative when their top bit is set
+   */
+  template<typename word_t>
+  mabit<word_t>		from_twos_complement(const std::vector<word_t>& words)
+  {
+    const bool		negative = !words.empty() && words.back() >> (sizeof(word_t) * 8 - 1);
+    mabit<word_t>	ret;
+    bool		carry = true;
+
+    ret.resize(words.size());
+    for (size_t i = 0; i < words.size(); ++i)
+      {
+	ret[i] = negative ? static_cast<word_t>(~words[i] + carry) : words[i];
+	carry = carry && !words[i];
+      }
+    if (negative)
+      ret.negate();
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** Applies `f` to the two's complements of `a` and `b`, wide enough to keep both signs
+   */
+  template<typename word_t, typename Function>
+  mabit<word_t>		twos_bitwise(const mabit<word_t>& a, const mabit<word_t>& b, Function f)
+  {
+    const size_t	n = std::max(a.used_words(), b.used_words()) + 1;
+    const std::vector<word_t>	u = twos_complement(a, n);
+    const std::vector<word_t>	v = twos_complement(b, n);
+    std::vector<word_t>	ret(n);
+
+    for (size_t i = 0; i < n; ++i)
+      ret[i] = f(u[i], v[i]);
+    return from_twos_complement(ret);
+  }
+
+  /**
+   ** \brief
+   ** 2^k, sized to hold it
+   */
+  template<typename word_t>
+  mabit<word_t>		power_of_2(const size_t k)
+  {
+    mabit<word_t>	ret;
+
+    ret.resize(k / (sizeof(word_t) * 8) + 1);
+    ret.set_bit(k, true);
+    return ret;
+  }
+
+  /**
+   ** \brief
+   ** x^e mod m, multiplying and reducing by % a bit at a time, m > 0 and e >= 0
+   */
+  template<typename word_t>
+  mabit<word_t>		power_mod(const mabit<word_t>& x, const mabit<word_t>& e, const mabit<word_t>& m)
+  {
+    mabit<word_t>	ret(1);
+    mabit<word_t>	base = x % m;
+
+    if (base < mabit<word_t>(0))
+      base += m;
+    for (size_t i = e.used_bits(); i > 0; --i)
+      {
+	ret = ret * ret % m;
+	if (e.get_bit(i - 1))
+	  ret = ret * base % m;
+      }
+    return ret % m;
+  }
+
+  template<typename word_t>
+  mabit<word_t>		power(const mabit<word_t>& x, size_t n)
+  {
+    mabit<word_t>	ret(1);
+    mabit<word_t>	base(x);
+
+    for (; n; n >>= 1)
+      {
+	if (n & 1)
+	  ret *= base;
+	if (n > 1)
+	  base *= base;
+      }
+    return ret;
+  }
+
+  /************************************************************************/
+  /* CHECKS                                                               */
+  /************************************************************************/
+  template<typename word_t>
+  void			check_multiplication()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = rng() % 3 ? random<word_t>() : random<word_t>(rng() % 200);
+	const mabit<word_t>	expected = schoolbook(a, b);
+
+	CHECK(a * b == expected, "a * b against schoolbook");
+	CHECK(b * a == expected, "b * a against schoolbook");
+	CHECK(a * a == schoolbook(a, a), "a * a against schoolbook");
+	CHECK(a.square() == schoolbook(a, a), "square() against schoolbook");
+
+	// The fused forms accumulate in the words of the destination, which may be an operand
+	const mabit<word_t>	c = random<word_t>();
+	mabit<word_t>		x = c;
+
+	x.addmul(a, b);
+	CHECK(x == c + expected, "addmul() against the product");
+	x.submul(a, b);
+	CHECK(x == c, "submul() against the product");
+	x = a;
+	x.submul(x, b);
+	CHECK(x == a - expected, "submul() of ourself");
+	x = c;
+	x += a * b;
+	CHECK(x == c + expected, "x += a * b");
+	x = a * b + c - a * c;
+	CHECK(x == expected + c - schoolbook(a, c), "a * b + c - a * c");
+      }
+
+    // A few operands past MABIT_NTT_THRESHOLD words
+    for (int i = 0; i < 2; ++i)
+      {
+	const size_t		bits = (MABIT_NTT_THRESHOLD + rng() % 300) * sizeof(word_t) * 8;
+	const mabit<word_t>	a = random<word_t>(bits);
+	const mabit<word_t>	b = random<word_t>(bits - rng() % (bits / 2));
+
+	CHECK(a * b == schoolbook(a, b), "NTT sized a * b against schoolbook");
+	CHECK(a.square() == schoolbook(a, a), "NTT sized square() against schoolbook");
+      }
+  }
+
+  /**
+   ** \brief
+   ** Checks the quotient and the remainder of a / b, b != 0
+   */
+  template<typename word_t>
+  void			check_quotient(const mabit<word_t>& a, const mabit<word_t>& b)
+  {
+    const mabit<word_t>	q = a / b;
+    const mabit<word_t>	r = a % b;
+
+    CHECK(q * b + r == a, "q * b + r = a");
+    CHECK(r.abs() < b.abs(), "|r| < |b|");
+    CHECK(!r.any() || (r < mabit<word_t>(0)) == (a < mabit<word_t>(0)), "r takes the sign of a");
+
+    mabit<word_t>	quotient;
+    mabit<word_t>	remainder;
+
+    a.divmod(b, quotient, remainder);
+    CHECK(quotient == q && remainder == r, "divmod() agrees with / and %");
+
+    const word_t	d = static_cast<word_t>(rng() | 1);
+    const word_t	rest = a.divmod(d, quotient);
+
+    CHECK(quotient == a / mabit<word_t>(d), "divmod() by a word agrees with /");
+    CHECK(mabit<word_t>(rest) == mabit<word_t>(a % mabit<word_t>(d)).abs(), "divmod() by a word returns |a % d|");
+  }
+
+  template<typename word_t>
+  void			check_division()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = random<word_t>(rng() % (a.used_bits() + 1));
+
+	if (b.any())
+	  check_quotient(a, b);
+      }
+
+    // Divisors past MABIT_DC_DIV_THRESHOLD words, and dividends up to three times as long
+    for (int i = 0; i < ITERATIONS / 6; ++i)
+      {
+	const size_t		word_bits = sizeof(word_t) * 8;
+	const mabit<word_t>	b = random<word_t>((MABIT_DC_DIV_THRESHOLD + 1 + rng() % 60) * word_bits);
+	const mabit<word_t>	a = random<word_t>(b.used_bits() * (1 + rng() % 3) + rng() % word_bits);
+
+	if (b.any())
+	  check_quotient(a, b);
+      }
+  }
+
+  /**
+   ** \brief
+   ** Native integer operands give the same results as their mabit
+   */
+  template<typename word_t, typename int_type>
+  void			check_native(const mabit<word_t>& a, const int_type v)
+  {
+    const mabit<word_t>	m(v);
+    mabit<word_t>	x;
+
+    CHECK(a + v == a + m && a - v == a - m && a * v == a * m, "+ - * of a native integer");
+    x = a;
+    x += v;
+    x -= v;
+    x *= v;
+    CHECK(x == a * m, "+= -= *= of a native integer");
+    if (v)
+      {
+	CHECK(a / v == a / m && a % v == a % m, "/ % of a native integer");
+	x = a;
+	x /= v;
+	CHECK(x == a / m, "/= of a native integer");
+	x = a;
+	x %= v;
+	CHECK(x == a % m, "%= of a native integer");
+      }
+  }
+
+  template<typename word_t>
+  void			check_natives()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+
+	check_native(a, static_cast<int>(rng()));
+	check_native(a, static_cast<int>(rng() % 21) - 10);
+	check_native(a, static_cast<unsigned>(rng()));
+	check_native(a, static_cast<long long>(rng()));
+	check_native(a, static_cast<word_t>(rng()));
+      }
+  }
+
+  /**
+   ** \brief
+   ** Whether parsing `src` in `base` throws std::invalid_argument, leaving the number untouched
+   */
+  template<typename word_t>
+  bool			rejects(const std::string& src, const int base)
+  {
+    mabit<word_t>	nb(12345);
+
+    try
+      {
+	nb.from_string(src, base);
+      }
+    catch (const std::invalid_argument&)
+      {
+	return nb == mabit<word_t>(12345);
+      }
+    return false;
+  }
+
+  template<typename word_t>
+  void			check_conversions()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const std::string	digits = decimal(a);
+
+	CHECK(mabit_stream<word_t>::to_string(a, DEC) == digits, "to_string() against divisions by 10");
+
+	const mabit<word_t>	m = a.abs();
+	std::string		bin;
+
+	for (size_t bit = std::max<size_t>(m.used_words(), 1) * sizeof(word_t) * 8; bit > 0; --bit)
+	  bin += m.get_bit(bit - 1) ? '1' : '0';
+	CHECK(mabit_stream<word_t>::to_string(m, BIN) == bin, "binary output against get_bit()");
+	CHECK(mabit_stream<word_t>::to_string(m, OCT) == pow2_digits(m, 3, 2), "octal output against get_bit()");
+	CHECK(mabit_stream<word_t>::to_string(m, HEX) == pow2_digits(m, 4, 2), "hexadecimal output against get_bit()");
+	CHECK(mabit<word_t>(digits) == a, "decimal parsing");
+
+	std::string		hex = pow2_digits(a.abs(), 4, 0);
+
+	CHECK(mabit<word_t>(hex, 16) == a.abs(), "hexadecimal parsing");
+	for (size_t j = 0; j < hex.size(); ++j)
+	  if (hex[j] >= 'A')
+	    hex[j] = static_cast<char>(hex[j] - 'A' + 'a');
+	CHECK(mabit<word_t>(hex, 16) == a.abs(), "lower case hexadecimal parsing");
+
+	// Horner's rule in base 7
+	std::string		text;
+	mabit<word_t>		expected;
+
+	for (size_t j = rng() % 600; j > 0; --j)
+	  {
+	    const word_t	digit = static_cast<word_t>(rng() % 7);
+
+	    text += static_cast<char>('0' + digit);
+	    expected = expected * mabit<word_t>(7) + mabit<word_t>(digit);
+	  }
+	CHECK(text.empty() || mabit<word_t>(text, 7) == expected, "base 7 parsing against Horner's rule");
+      }
+
+    CHECK(rejects<word_t>("1", 0) && rejects<word_t>("1", 1) && rejects<word_t>("1", 37), "bases out of [2, 36] are rejected");
+    CHECK(rejects<word_t>("12 3", 10) && rejects<word_t>("1-", 10) && rejects<word_t>("19", 8) && rejects<word_t>("1g", 16),
+	  "characters which are not digits of the base are rejected");
+    CHECK(rejects<word_t>("z", 35) && mabit<word_t>("Zz", 36) == mabit<word_t>(35 * 36 + 35), "base 36 digits");
+  }
+
+  /**
+   ** \brief
+   ** Bitwise operators act like on two's complement, shifts like multiplications and floor divisions by 2^k
+   */
+  template<typename word_t>
+  void			check_bitwise()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = random<word_t>();
+
+	CHECK((a & b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u & v); }), "a & b against two's complement");
+	CHECK((a | b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u | v); }), "a | b against two's complement");
+	CHECK((a ^ b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u ^ v); }), "a ^ b against two's complement");
+	CHECK(~a == -a - mabit<word_t>(1), "~a = -a - 1");
+
+	const size_t		k = rng() % 200;
+	const mabit<word_t>	p = power_of_2<word_t>(k);
+	mabit<word_t>		x = a;
+	mabit<word_t>		q = a / p;
+
+	x.resize(a.used_words() + k / (sizeof(word_t) * 8) + 1);
+	x <<= k;
+	CHECK(x == a * p, "a << k = a 2^k");
+	if (q * p != a && a < mabit<word_t>(0))
+	  q -= mabit<word_t>(1);
+	x = a;
+	x >>= k;
+	CHECK(x == q, "a >> k rounds toward minus infinity");
+      }
+  }
+
+  /**
+   ** \brief
+   ** The count of used words follows the writes through operator []
+   */
+  template<typename word_t>
+  void			check_used_words()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	mabit<word_t>		a = random<word_t>();
+	const mabit<word_t>&	c = a;
+	const size_t		at = rng() % a.size();
+	size_t			words;
+
+	a[at] = static_cast<word_t>(rng() % 2 ? rng() : 0);
+	if (rng() % 2)
+	  a.resize(a.size() + rng() % 5);
+	for (words = c.size(); words > 0 && !c[words - 1]; --words)
+	  ;
+	CHECK(a.used_words() == words, "used_words() against a scan of the words");
+	CHECK(a.used_bits() <= words * sizeof(word_t) * 8 && (!words || a.get_bit(a.used_bits() - 1)), "used_bits()");
+	CHECK(a.any() == (words != 0), "any() against a scan of the words");
+      }
+
+    // Clearing a negative value word by word leaves 0, not -0, whichever call sees it first
+    for (int i = 0; i < 4; ++i)
+      {
+	mabit<word_t>		z(-5);
+	const mabit<word_t>	minus_5(-5);
+
+	z[0] = 0;
+	switch (i)
+	  {
+	  case 0:
+	    CHECK(z == mabit<word_t>(0) && !(z < mabit<word_t>(0)) && mabit<word_t>(0) == z, "a cleared magnitude compares as 0");
+	    break;
+	  case 1:
+	    CHECK(mabit_stream<word_t>::to_string(z, DEC) == "0" && mabit_stream<word_t>::to_string(z, HEX) == "0", "a cleared magnitude prints 0");
+	    break;
+	  case 2:
+	    CHECK((z ^ minus_5) == minus_5 && (z | minus_5) == minus_5 && (z & minus_5) == mabit<word_t>(0), "bitwise operators on a cleared magnitude");
+	    break;
+	  default:
+	    CHECK(z.is_perfect_square() && minus_5.powmod(z, mabit<word_t>(7)) == mabit<word_t>(1), "is_perfect_square() and a null exponent");
+	  }
+      }
+  }
+
+  /**
+   ** \brief
+   ** Copies and moves between values held inside the object and values held in the heap
+   */
+  template<typename word_t>
+  void			check_storage()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	small = random<word_t>(rng() % 64);
+	const mabit<word_t>	big = random<word_t>();
+	mabit<word_t>		x(small);
+	mabit<word_t>		y(big);
+
+	CHECK(x == small && y == big, "copies");
+	x = big;
+	y = small;
+	CHECK(x == big && y == small, "assignments across storages");
+
+	mabit<word_t>		z(std::move(x));
+
+	CHECK(z == big, "move of a value");
+	x = std::move(y);
+	CHECK(x == small, "move assignment");
+	y = z;
+	z = std::move(z);
+	x = x;
+	CHECK(y == big && x == small, "self assignments");
+	y = x + big;
+	CHECK(y - big == small, "arithmetic on moved from values");
+	std::swap(x, z);
+	CHECK(x == big && z == small, "std::swap()");
+      }
+  }
+
+  /**
+   ** \brief
+   ** A mabit drawing its words from mabit_pool_allocator matches one using std::allocator
+   */
+  template<typename word_t>
+  void			check_pool()
+  {
+    typedef mabit<word_t, mabit_pool_allocator<word_t> >		pooled_t;
+    typedef mabit_stream<word_t, mabit_pool_allocator<word_t> >	pooled_stream_t;
+
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = random<word_t>();
+	const std::string	a_digits = mabit_stream<word_t>::to_string(a, DEC);
+	const pooled_t		x(a_digits);
+	const pooled_t		y(mabit_stream<word_t>::to_string(b, DEC));
+	pooled_t		z(x);
+
+	CHECK(pooled_stream_t::to_string(x, DEC) == a_digits, "pooled round trip");
+	z *= y;
+	z += x;
+	CHECK(pooled_stream_t::to_string(z, DEC)
+	      == mabit_stream<word_t>::to_string(mabit<word_t>(a * b + a), DEC), "pooled x * y + x");
+	if (b.any())
+	  {
+	    z = x;
+	    z /= y;
+	    CHECK(pooled_stream_t::to_string(z, DEC)
+		  == mabit_stream<word_t>::to_string(mabit<word_t>(a / b), DEC), "pooled x / y");
+	  }
+      }
+  }
+
+  /**
+   ** \brief
+   ** An expiring operand read again by the same expression keeps its value, whichever side it is on
+   */
+  template<typename word_t>
+  void			check_expressions()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = random<word_t>();
+	const mabit<word_t>	twice = a + a;
+	mabit<word_t>		x;
+	mabit<word_t>		y;
+
+	y = a;
+	x = std::move(y) + y;
+	CHECK(x == twice, "std::move(y) + y");
+	y = a;
+	x = y + std::move(y);
+	CHECK(x == twice, "y + std::move(y)");
+	y = a;
+	x = std::move(y) * b + y;
+	CHECK(x == a * b + a, "std::move(y) * b + y");
+	y = a;
+	x = y - -std::move(y);
+	CHECK(x == twice, "y - -std::move(y)");
+	y = a;
+	y = std::move(y) + y;
+	CHECK(y == twice, "y = std::move(y) + y");
+	y = a;
+	y += std::move(y) + b;
+	CHECK(y == twice + b, "y += std::move(y) + b");
+	y = a;
+	y -= b * std::move(y);
+	CHECK(y == a - b * a, "y -= b * std::move(y)");
+
+	// Native integers and abs() on an expiring operand build nodes too
+	y = a;
+	x = std::move(y) * 3 + y;
+	CHECK(x == a * 4, "std::move(y) * 3 + y");
+	y = a;
+	x = std::move(y) + 1 + y;
+	CHECK(x == twice + 1, "std::move(y) + 1 + y");
+	y = a;
+	x = y + std::move(y).abs();
+	CHECK(x == a + a.abs(), "y + std::move(y).abs()");
+	y = a;
+	x = (std::move(y) - b) % 7 + y;
+	CHECK(x == mabit<word_t>(a - b) % 7 + a, "(std::move(y) - b) % 7 + y");
+	y = a;
+	x = (std::move(y) ^ 5) & y;
+	CHECK(x == ((a ^ 5) & a), "(std::move(y) ^ 5) & y");
+	y = a;
+	y = std::move(y) * 3 - 1;
+	CHECK(y == a * 3 - 1, "y = std::move(y) * 3 - 1");
+      }
+  }
+
+  /**
+   ** \brief
+   ** Bitwise operators, flip(), turn_bits() and shifts around MABIT_SIMD_THRESHOLD bytes, against word by word references
+   */
+  template<typename word_t>
+  void			check_simd()
+  {
+    const size_t	threshold_bits = MABIT_SIMD_THRESHOLD * 8;
+
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const size_t		bits = threshold_bits / 2 + rng() % (threshold_bits * 2);
+	const mabit<word_t>	a = random<word_t>(bits);
+	const mabit<word_t>	b = random<word_t>(rng() % 2 ? bits : rng() % (threshold_bits * 3));
+	mabit<word_t>		x;
+
+	CHECK((a & b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u & v); }), "a & b against two's complement");
+	CHECK((a | b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u | v); }), "a | b against two's complement");
+	CHECK((a ^ b) == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u ^ v); }), "a ^ b against two's complement");
+	CHECK(~a == -a - mabit<word_t>(1), "~a = -a - 1");
+	x = a;
+	x &= ~b;
+	CHECK(x == twos_bitwise(a, b, [] (word_t u, word_t v) { return static_cast<word_t>(u & ~v); }), "a &= ~b against two's complement");
+
+	// flip() and turn_bits() work on the magnitude, within size() words
+	mabit<word_t>		expected;
+
+	x = a;
+	x.resize(x.size() + rng() % 4);
+	expected.resize(x.size());
+	for (size_t j = 0; j < x.size(); ++j)
+	  expected[j] = static_cast<word_t>(~static_cast<const mabit<word_t>&>(x)[j]);
+	if (a < mabit<word_t>(0))
+	  expected.negate();
+	x.flip();
+	CHECK(x == expected, "flip() against the words");
+	x.turn_bits(true);
+	CHECK(x.used_words() == x.size() && x.all(), "turn_bits(true)");
+	x.turn_bits(false);
+	CHECK(!x.any() && !(x < mabit<word_t>(0)), "turn_bits(false)");
+
+	const size_t		k = rng() % (threshold_bits * 2);
+	const mabit<word_t>	p = power_of_2<word_t>(k);
+	mabit<word_t>		q = a / p;
+
+	x = a;
+	x.resize(a.used_words() + k / (sizeof(word_t) * 8) + 1);
+	x <<= k;
+	CHECK(x == a * p, "a << k = a 2^k");
+	if (q * p != a && a < mabit<word_t>(0))
+	  q -= mabit<word_t>(1);
+	x = a;
+	x >>= k;
+	CHECK(x == q, "a >> k rounds toward minus infinity");
+      }
+  }
+
+  /**
+   ** \brief
+   ** Bit queries against get_bit() and set_bit(), one bit at a time
+   */
+  template<typename word_t>
+  void			check_bit_queries()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = random<word_t>();
+	const size_t		size = a.size() * sizeof(word_t) * 8;
+	const size_t		top = std::max(a.size(), b.size()) * sizeof(word_t) * 8;
+	size_t			ones = 0;
+	size_t			distance = 0;
+	size_t			lowest = size;
+	size_t			leading = size;
+
+	for (size_t bit = size; bit > 0; --bit)
+	  if (a.get_bit(bit - 1))
+	    {
+	      if (!ones++)
+		leading = size - bit;
+	      lowest = bit - 1;
+	    }
+	for (size_t bit = 0; bit < top; ++bit)
+	  distance += a.get_bit(bit) != b.get_bit(bit);
+
+	CHECK(a.popcount() == ones, "popcount() against get_bit()");
+	CHECK(a.count_leading_zeros() == leading, "count_leading_zeros() against get_bit()");
+	CHECK(a.count_trailing_zeros() == lowest, "count_trailing_zeros() against get_bit()");
+	CHECK(a.hamming_distance(b) == distance && b.hamming_distance(a) == distance, "hamming_distance() against get_bit()");
+	CHECK(a.is_power_of_2() == (ones == 1), "is_power_of_2() against popcount()");
+	CHECK(power_of_2<word_t>(rng() % 300).is_power_of_2(), "is_power_of_2() of 2^k");
+
+	const size_t		pos = rng() % (size + 8);
+	size_t			next = pos;
+
+	while (next < size && !a.get_bit(next))
+	  ++next;
+	CHECK(a.find_next_set(pos) == (next < size ? next : size), "find_next_set() against get_bit()");
+
+	const size_t		lo = rng() % (size + 8);
+	const size_t		hi = lo + rng() % (size + 8 - lo);
+	mabit<word_t>		extracted;
+	mabit<word_t>		x = a;
+	mabit<word_t>		expected = a;
+
+	extracted.resize((hi - lo) / (sizeof(word_t) * 8) + 1);
+	for (size_t bit = lo; bit < hi; ++bit)
+	  extracted.set_bit(bit - lo, a.get_bit(bit));
+	CHECK(a.extract_bits(lo, hi) == extracted, "extract_bits() against get_bit()");
+
+	x.set_range(lo, hi);
+	for (size_t bit = lo; bit < hi; ++bit)
+	  expected.set_bit(bit, true);
+	CHECK(x == expected, "set_range() against set_bit()");
+	x.clear_range(lo, hi);
+	for (size_t bit = lo; bit < hi; ++bit)
+	  expected.set_bit(bit, false);
+	CHECK(x == expected, "clear_range() against set_bit()");
+      }
+  }
+
+  template<typename word_t>
+  void			check_addition()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = rng() % 3 ? random<word_t>() : random<word_t>(rng() % 100);
+	const mabit<word_t>	sum = wordwise_sum(a, b);
+	const mabit<word_t>	difference = wordwise_sum(a, mabit<word_t>(-b));
+	mabit<word_t>		x = a;
+
+	CHECK(a + b == sum && b + a == sum, "a + b against the words");
+	CHECK(a - b == difference, "a - b against the words");
+	x += b;
+	CHECK(x == sum, "a += b against the words");
+	x -= b;
+	x -= b;
+	CHECK(x == difference, "a -= b against the words");
+	x = a;
+	x += x;
+	CHECK(x == wordwise_sum(a, a), "a += a");
+	x -= x;
+	CHECK(!x.any() && !(x < mabit<word_t>(0)), "a -= a");
+      }
+  }
+
+  template<typename word_t>
+  void			check_comparisons()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>();
+	const mabit<word_t>	b = rng() % 4 ? random<word_t>() : a + mabit<word_t>(static_cast<int>(rng() % 3) - 1);
+	const mabit<word_t>	d = a - b;
+	const int		expected = d < mabit<word_t>(0) ? -1 : d.any() ? 1 : 0;
+
+	CHECK(a.compare(b) == expected && b.compare(a) == -expected, "compare() against the sign of a - b");
+	CHECK(a.compare(a) == 0 && a.compare(mabit<word_t>(a)) == 0, "compare() with itself");
+	CHECK((a == b) == !expected && (a != b) == !!expected, "== !=");
+	CHECK((a < b) == (expected < 0) && (a <= b) == (expected <= 0), "< <=");
+	CHECK((a > b) == (expected > 0) && (a >= b) == (expected >= 0), "> >=");
+#ifdef MABIT_THREE_WAY_COMPARISON
+	CHECK((a <=> b) == (expected <=> 0), "<=> against the sign of a - b");
+#endif
+      }
+  }
+
+  template<typename word_t>
+  void			check_modular()
+  {
+    for (int i = 0; i < ITERATIONS / 2; ++i)
+      {
+	mabit<word_t>		m = random<word_t>(1 + rng() % 700).abs();
+	const mabit<word_t>	x = random<word_t>(rng() % 1400);
+	const mabit<word_t>	y = random<word_t>(rng() % 1400);
+	const mabit<word_t>	e = random<word_t>(rng() % 64).abs();
+
+	if (m < mabit<word_t>(2))
+	  m = mabit<word_t>(2);
+
+	const mabit<word_t>	expected = power_mod(x, e, m);
+
+	CHECK(x.powmod(e, m) == expected, "powmod() against square and multiply");
+
+	const mabit_modulus<word_t>	ctx(m);
+	mabit<word_t>		xy = x * y % m;
+
+	if (xy < mabit<word_t>(0))
+	  xy += m;
+	CHECK(ctx.mulmod(x, y) == xy, "mabit_modulus::mulmod() against %");
+	CHECK(ctx.powmod(x, e) == expected, "mabit_modulus::powmod() against square and multiply");
+	CHECK(ctx.from_residue(ctx.mul(ctx.to_residue(x), ctx.to_residue(y))) == xy, "residue products");
+      }
+
+    bool		rejected = false;
+
+    try
+      {
+	mabit_modulus<word_t>	ctx((mabit<word_t>()));
+      }
+    catch (const std::invalid_argument&)
+      {
+	rejected = true;
+      }
+    CHECK(rejected, "mabit_modulus rejects a null modulus");
+  }
+
+  template<typename word_t>
+  void			check_gcd()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	c = random<word_t>(rng() % 400);
+	const mabit<word_t>	a = random<word_t>() * c;
+	const mabit<word_t>	b = random<word_t>() * c;
+	mabit<word_t>		s;
+	mabit<word_t>		t;
+	const mabit<word_t>	g = a.gcdext(b, s, t);
+
+	// Any common divisor divides s a + t b, so g is the greatest one
+	CHECK(g == s * a + t * b, "g = s a + t b");
+	CHECK(!g.any() || (!mabit<word_t>(a % g).any() && !mabit<word_t>(b % g).any()), "g divides a and b");
+	CHECK(a.gcd(b) == g, "gcd() against gcdext()");
+	CHECK(!g.any() || a.lcm(b) * g == mabit<word_t>(a * b).abs(), "lcm() g = |a b|");
+
+	mabit<word_t>		inverse;
+	const mabit<word_t>	m = b.abs();
+
+	if (a.invmod(b, inverse))
+	  CHECK(m == mabit<word_t>(1) || (a * inverse % m + m) % m == mabit<word_t>(1), "a invmod(b) = 1 mod b");
+	else
+	  CHECK(!m.any() || g != mabit<word_t>(1), "invmod() fails only without an inverse");
+      }
+  }
+
+  template<typename word_t>
+  void			check_roots()
+  {
+    for (int i = 0; i < ITERATIONS; ++i)
+      {
+	const mabit<word_t>	a = random<word_t>().abs();
+	mabit<word_t>		s;
+	mabit<word_t>		r;
+
+	a.sqrtrem(s, r);
+	CHECK(s * s + r == a && r <= s + s, "s^2 <= a < (s + 1)^2");
+	CHECK(a.isqrt() == s, "isqrt() against sqrtrem()");
+	CHECK(a.is_perfect_square() == !r.any(), "is_perfect_square() against sqrtrem()");
+
+	const size_t		n = 3 + rng() % 10;
+	const mabit<word_t>	root = a.iroot(n);
+
+	CHECK(power(root, n) <= a && power(mabit<word_t>(root + mabit<word_t>(1)), n) > a, "r^n <= a < (r + 1)^n");
+
+	// Powers made on purpose, and their neighbours
+	const mabit<word_t>	x = random<word_t>(2 + rng() % 200);
+	const size_t		k = 2 + rng() % 9;
+	const mabit<word_t>	p = power(x, k);
+
+	CHECK(p.is_perfect_power(), "x^k is a perfect power");
+	CHECK(p.iroot(k) == x || (k % 2 == 0 && p.iroot(k) == x.abs()), "iroot(k) of x^k");
+	if (p.abs() > mabit<word_t>(8))
+	  {
+	    const mabit<word_t>	q(p + mabit<word_t>(1));
+	    bool		expected = false;
+
+	    for (size_t j = 2; j < q.used_bits() && !expected; ++j)
+	      expected = power(q.iroot(j), j) == q;
+	    CHECK(q.is_perfect_power() == expected, "is_perfect_power() against every root");
+	  }
+      }
+  }
+
+  template<typename word_t>
+  void			check()
+  {
+    check_expressions<word_t>();
+    check_multiplication<word_t>();
+    check_division<word_t>();
+    check_natives<word_t>();
+    check_conversions<word_t>();
+    check_bitwise<word_t>();
+    check_used_words<word_t>();
+    check_storage<word_t>();
+    check_pool<word_t>();
+    check_simd<word_t>();
+    check_bit_queries<word_t>();
+    check_addition<word_t>();
+    check_comparisons<word_t>();
+    check_modular<word_t>();
+    check_gcd<word_t>();
+    check_roots<word_t>();
+  }
+}
+
+int			main()
+{
+  check<unsigned char>();
+  check<unsigned short>();
+  check<unsigned int>();
+#ifdef __SIZEOF_INT128__
+  check<unsigned long long>();
+#endif
+
+  if (failures)
+    std::printf("%d check(s) failed\n", failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}